@@ -0,0 +1,111 @@
+#include "corpus.hpp"
+
+#include <charconv>
+#include <fstream>
+#include <stdexcept>
+
+namespace pyson_bench {
+
+uint64_t Random::next() noexcept {
+    uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+uint64_t Random::below(uint64_t bound) noexcept {
+    // the modulo bias is irrelevant for benchmark data
+    return next() % bound;
+}
+
+size_t Random::in(LengthRange range) noexcept {
+    if (range.max <= range.min) return range.min;
+    return range.min + static_cast<size_t>(below(range.max - range.min + 1));
+}
+
+std::string record_name(size_t index, size_t name_length) {
+    // the index in base 26, padded with leading 'a's (zeros) up to name_length
+    std::string digits;
+    do {
+        digits.push_back(static_cast<char>('a' + index % 26));
+        index /= 26;
+    } while (index != 0);
+    if (digits.size() < name_length) digits.append(name_length - digits.size(), 'a');
+    return std::string(digits.rbegin(), digits.rend());
+}
+
+namespace {
+
+constexpr char text_alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 _-.,";
+
+void append_text(std::string& out, Random& random, size_t length) {
+    for (size_t i = 0; i < length; i++)
+        out.push_back(text_alphabet[random.below(sizeof(text_alphabet) - 1)]);
+}
+
+template <class Number>
+void append_number(std::string& out, Number number) {
+    char buffer[64];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+    out.append(buffer, result.ptr);
+}
+
+}
+
+std::string generate_corpus(const CorpusOptions& options, CorpusStats *stats) {
+    const uint64_t total_weight = uint64_t{options.int_weight} + options.float_weight
+        + options.str_weight + options.list_weight;
+    if (total_weight == 0)
+        throw std::invalid_argument("At least one type weight must be non-zero in generate_corpus()");
+
+    CorpusStats counts{};
+    Random random(options.seed);
+    std::string out;
+    out.reserve(options.target_bytes + 4096);
+
+    for (size_t index = 0; out.size() < options.target_bytes; index++) {
+        out += record_name(index, options.name_length);
+        uint64_t pick = random.below(total_weight);
+        if (pick < options.int_weight) {
+            out += ":int:";
+            append_number(out, static_cast<int>(random.next() >> 33) - (1 << 30));
+            counts.ints++;
+        } else if ((pick -= options.int_weight) < options.float_weight) {
+            out += ":float:";
+            double unit = static_cast<double>(random.next() >> 11) / static_cast<double>(1ull << 53);
+            append_number(out, unit * 2e6 - 1e6);
+            counts.floats++;
+        } else if ((pick -= options.float_weight) < options.str_weight) {
+            out += ":str:";
+            append_text(out, random, random.in(options.string_length));
+            counts.strs++;
+        } else {
+            out += ":list:";
+            size_t elements = random.in(options.list_length);
+            for (size_t i = 0; i < elements; i++) {
+                if (i != 0) out += "(*)";
+                append_text(out, random, random.in(options.string_length));
+            }
+            counts.lists++;
+        }
+        out.push_back('\n');
+        counts.records++;
+    }
+
+    counts.bytes = out.size();
+    if (stats != nullptr) *stats = counts;
+    return out;
+}
+
+CorpusStats write_corpus(const std::string& path, const CorpusOptions& options) {
+    CorpusStats stats{};
+    std::string corpus = generate_corpus(options, &stats);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(corpus.data(), static_cast<std::streamsize>(corpus.size()));
+    file.close();
+    if (!file)
+        throw std::runtime_error("Could not write the corpus to " + path + " in write_corpus()");
+    return stats;
+}
+
+}
@@ -0,0 +1,75 @@
+// Deterministic generator for synthetic pyson corpora, used by the benchmarks.
+//
+// The same options and seed always produce byte-for-byte the same corpus, on every
+// platform and standard library, so benchmark numbers from different machines or
+// different versions of pyson are measured against the same input.
+
+#ifndef PYSON_BENCH_CORPUS_HPP
+#define PYSON_BENCH_CORPUS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace pyson_bench {
+
+/// An inclusive range of lengths
+struct LengthRange {
+    size_t min;
+    size_t max;
+};
+
+/// What the generated corpus should look like
+struct CorpusOptions {
+    /// Approximate size of the corpus in bytes, generation stops at the first line past it
+    size_t target_bytes = 16 << 20;
+    /// Seed for the random number generator, the same seed gives the same corpus
+    uint64_t seed = 1;
+    /// Length of every name (longer if it is too short to keep every name unique)
+    size_t name_length = 16;
+    /// Relative weights of each type, they don't have to add up to anything in particular
+    unsigned int_weight = 1;
+    unsigned float_weight = 1;
+    unsigned str_weight = 1;
+    unsigned list_weight = 1;
+    /// Number of elements in each list
+    LengthRange list_length = {1, 8};
+    /// Length of each string, and of each list element
+    LengthRange string_length = {4, 32};
+};
+
+/// Counts of what ended up in a generated corpus
+struct CorpusStats {
+    size_t bytes = 0;
+    size_t records = 0;
+    size_t ints = 0;
+    size_t floats = 0;
+    size_t strs = 0;
+    size_t lists = 0;
+};
+
+/// Small, fast and fully specified PRNG (splitmix64), unlike the std distributions
+class Random {
+public:
+    explicit Random(uint64_t seed) noexcept : m_state(seed) {}
+    uint64_t next() noexcept;
+    /// Uniform-ish integer in [0, bound), bound must not be 0
+    uint64_t below(uint64_t bound) noexcept;
+    /// Uniform-ish integer in [range.min, range.max]
+    size_t in(LengthRange range) noexcept;
+private:
+    uint64_t m_state;
+};
+
+/// The name of record number index for the given name length, unique per index
+std::string record_name(size_t index, size_t name_length);
+
+/// Generate a corpus in memory, one record per line, every line ending in a newline
+std::string generate_corpus(const CorpusOptions& options, CorpusStats *stats = nullptr);
+
+/// Generate a corpus and write it to path, throws a std::runtime_error if the file can't be written
+CorpusStats write_corpus(const std::string& path, const CorpusOptions& options);
+
+}
+
+#endif //PYSON_BENCH_CORPUS_HPP
@@ -0,0 +1,94 @@
+// Microbenchmark for the pyson line parser.
+// Compares the old istringstream + std::getline + std::stoi/std::stod parser
+// against pyson::parse_line() for each PysonType, in lines per second.
+//
+// Built by CMake as the pyson_parse_bench target, or from the repository root with:
+//     g++ -O2 -std=c++20 -I. bench/parse_bench.cpp pyson.cpp -o parse_bench && ./parse_bench
+
+#include "pyson.hpp"
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The parser as it was before parse_line(), kept here so there is something to compare against
+bool legacy_parse(const std::string& line, std::string& name, pyson::Value& value) {
+    std::istringstream i(line);
+    std::string current_token{};
+    std::getline(i, current_token, ':');
+    name = current_token;
+
+    std::getline(i, current_token, ':');
+    std::string tag = current_token;
+    std::getline(i, current_token);
+    try {
+        if (tag == "int") value = pyson::Value(std::stoi(current_token));
+        else if (tag == "float") value = pyson::Value(std::stod(current_token));
+        else if (tag == "str") value = pyson::Value(current_token);
+        else if (tag == "list") value = pyson::Value::from_pyson_list(current_token);
+        else return false;
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> make_lines(pyson::PysonType type, size_t count) {
+    std::vector<std::string> lines;
+    lines.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        std::string line = "value_number_" + std::to_string(i);
+        switch (type) {
+            case pyson::PysonType::PysonInt: line += ":int:" + std::to_string(i * 7919 % 1000003); break;
+            case pyson::PysonType::PysonFloat: line += ":float:" + std::to_string(i * 0.3183098861); break;
+            case pyson::PysonType::PysonStr: line += ":str:the quick brown fox jumps over the lazy dog"; break;
+            case pyson::PysonType::PysonList: line += ":list:alpha(*)beta(*)gamma(*)delta(*)epsilon"; break;
+        }
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+template <class Parse>
+double lines_per_second(const std::vector<std::string>& lines, Parse parse) {
+    auto start = std::chrono::steady_clock::now();
+    size_t parsed = 0;
+    for (const std::string& line : lines)
+        parsed += parse(line) ? 1 : 0;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (parsed != lines.size()) std::fprintf(stderr, "parse failure in benchmark\n");
+    return static_cast<double>(lines.size()) / elapsed.count();
+}
+
+}
+
+int main() {
+    constexpr size_t line_count = 1000000;
+    const pyson::PysonType types[] = {
+        pyson::PysonType::PysonInt,
+        pyson::PysonType::PysonFloat,
+        pyson::PysonType::PysonStr,
+        pyson::PysonType::PysonList,
+    };
+
+    std::printf("%-6s %16s %16s %8s\n", "type", "legacy lines/s", "parse_line/s", "speedup");
+    for (pyson::PysonType type : types) {
+        std::vector<std::string> lines = make_lines(type, line_count);
+
+        std::string name;
+        pyson::Value value(0);
+        double before = lines_per_second(lines, [&](const std::string& line) {
+            return legacy_parse(line, name, value);
+        });
+
+        pyson::NamedValue out("", pyson::Value(0));
+        double after = lines_per_second(lines, [&](const std::string& line) {
+            return pyson::parse_line(line.data(), line.size(), out);
+        });
+
+        std::printf("%-6s %16.0f %16.0f %7.2fx\n", value.type_cstring(), before, after, after / before);
+    }
+}
@@ -0,0 +1,493 @@
+// Benchmark suite for the pyson reader and Value, run against a synthetic corpus.
+//
+// Every benchmark reports throughput in MB/s (of pyson text read, or of text produced
+// for value_as_string()), records per second (lookups per second for value_with_name()
+// and go_to_line()), and heap allocations per record. Each benchmark is run --repeat
+// times; the fastest run is reported, and allocations are counted in the last run.
+//
+// Build with CMake (the pyson_bench target), then for example:
+//     ./pyson_bench --size-mb=64 --mix=4,2,1,1 --seed=7
+//     ./pyson_bench --corpus=corpus.pyson --generate-only
+// Run ./pyson_bench --help for every option.
+
+#include "pyson.hpp"
+#include "corpus.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Count every (unaligned) heap allocation made by the process
+namespace {
+std::atomic<size_t> allocation_count{0};
+}
+
+void *operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size != 0 ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+struct Settings {
+    pyson_bench::CorpusOptions corpus{};
+    std::string corpus_path{};
+    bool keep_corpus = false;
+    bool generate_only = false;
+    unsigned repeat = 3;
+    size_t lookups = 16;
+    std::string filter{};
+};
+
+/// What one run of a benchmark got through
+struct Work {
+    size_t bytes;
+    size_t records;
+};
+
+// Written to by the benchmarks so the compiler can't throw their work away
+volatile size_t sink = 0;
+
+void print_usage(const char *program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --size-mb=N            approximate corpus size in MiB (default 16)\n"
+        "  --seed=N               corpus seed (default 1)\n"
+        "  --name-length=N        length of every name (default 16)\n"
+        "  --mix=I,F,S,L          relative weights of int, float, str and list records (default 1,1,1,1)\n"
+        "  --list-length=MIN-MAX  elements per list (default 1-8)\n"
+        "  --string-length=MIN-MAX  length of strings and list elements (default 4-32)\n"
+        "  --corpus=PATH          write the corpus to PATH and keep it (default: a temporary file)\n"
+        "  --generate-only        only write the corpus, don't run any benchmarks\n"
+        "  --repeat=N             runs per benchmark, the fastest is reported (default 3)\n"
+        "  --lookups=N            lookups per run of value_with_name() and go_to_line() (default 16)\n"
+        "  --filter=TEXT          only run benchmarks whose name contains TEXT\n",
+        program
+    );
+}
+
+size_t parse_size(const std::string& text, const char *option) {
+    char *end = nullptr;
+    unsigned long long value = std::strtoull(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0')
+        throw std::invalid_argument(std::string("Expected a number for ") + option);
+    return static_cast<size_t>(value);
+}
+
+pyson_bench::LengthRange parse_range(const std::string& text, const char *option) {
+    size_t dash = text.find('-');
+    if (dash == std::string::npos) {
+        size_t both = parse_size(text, option);
+        return {both, both};
+    }
+    pyson_bench::LengthRange range{parse_size(text.substr(0, dash), option), parse_size(text.substr(dash + 1), option)};
+    if (range.max < range.min)
+        throw std::invalid_argument(std::string("Expected MIN-MAX with MIN <= MAX for ") + option);
+    return range;
+}
+
+Settings parse_arguments(int argc, char **argv) {
+    Settings settings{};
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        size_t equals = argument.find('=');
+        std::string key = argument.substr(0, equals);
+        std::string value = equals == std::string::npos ? "" : argument.substr(equals + 1);
+
+        if (key == "--help") { print_usage(argv[0]); std::exit(0); }
+        else if (key == "--size-mb") settings.corpus.target_bytes = parse_size(value, "--size-mb") << 20;
+        else if (key == "--seed") settings.corpus.seed = parse_size(value, "--seed");
+        else if (key == "--name-length") settings.corpus.name_length = parse_size(value, "--name-length");
+        else if (key == "--list-length") settings.corpus.list_length = parse_range(value, "--list-length");
+        else if (key == "--string-length") settings.corpus.string_length = parse_range(value, "--string-length");
+        else if (key == "--corpus") { settings.corpus_path = value; settings.keep_corpus = true; }
+        else if (key == "--generate-only") settings.generate_only = true;
+        else if (key == "--repeat") settings.repeat = static_cast<unsigned>(parse_size(value, "--repeat"));
+        else if (key == "--lookups") settings.lookups = parse_size(value, "--lookups");
+        else if (key == "--filter") settings.filter = value;
+        else if (key == "--mix") {
+            unsigned weights[4]{};
+            size_t start = 0;
+            for (unsigned& weight : weights) {
+                size_t comma = value.find(',', start);
+                weight = static_cast<unsigned>(parse_size(value.substr(start, comma - start), "--mix"));
+                if (comma == std::string::npos && &weight != &weights[3])
+                    throw std::invalid_argument("Expected four weights for --mix");
+                start = comma + 1;
+            }
+            settings.corpus.int_weight = weights[0];
+            settings.corpus.float_weight = weights[1];
+            settings.corpus.str_weight = weights[2];
+            settings.corpus.list_weight = weights[3];
+        } else {
+            throw std::invalid_argument("Unknown option " + argument + ", see --help");
+        }
+    }
+    if (settings.repeat == 0) settings.repeat = 1;
+    return settings;
+}
+
+class Runner {
+public:
+    explicit Runner(const Settings& settings) : m_settings(settings) {
+        std::printf("%-36s %10s %14s %12s\n", "benchmark", "MB/s", "records/s", "allocs/rec");
+    }
+
+    /// Time a benchmark, if bytes is 0 the MB/s column is left empty
+    void run(const char *name, const std::function<Work ()>& benchmark) {
+        if (!m_settings.filter.empty() && std::strstr(name, m_settings.filter.c_str()) == nullptr) return;
+
+        double best = 0;
+        Work work{};
+        size_t allocations = 0;
+        for (unsigned i = 0; i < m_settings.repeat; i++) {
+            size_t allocations_before = allocation_count.load(std::memory_order_relaxed);
+            auto start = std::chrono::steady_clock::now();
+            work = benchmark();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            allocations = allocation_count.load(std::memory_order_relaxed) - allocations_before;
+            if (i == 0 || elapsed.count() < best) best = elapsed.count();
+        }
+
+        double records = static_cast<double>(work.records);
+        if (work.bytes != 0)
+            std::printf("%-36s %10.1f", name, static_cast<double>(work.bytes) / (1 << 20) / best);
+        else
+            std::printf("%-36s %10s", name, "-");
+        std::printf(" %14.0f %12.3f\n", records / best, work.records != 0 ? allocations / records : 0.0);
+    }
+
+private:
+    const Settings& m_settings;
+};
+
+}
+
+int main(int argc, char **argv) {
+    Settings settings{};
+    try {
+        settings = parse_arguments(argc, argv);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 2;
+    }
+
+    if (settings.corpus_path.empty()) {
+        std::filesystem::path temporary = std::filesystem::temp_directory_path()
+            / ("pyson_bench_" + std::to_string(settings.corpus.seed) + ".pyson");
+        settings.corpus_path = temporary.string();
+    }
+
+    pyson_bench::CorpusStats stats = pyson_bench::write_corpus(settings.corpus_path, settings.corpus);
+    std::printf(
+        "corpus: %s\n  %zu bytes, %zu records (%zu int, %zu float, %zu str, %zu list), seed %llu\n\n",
+        settings.corpus_path.c_str(), stats.bytes, stats.records,
+        stats.ints, stats.floats, stats.strs, stats.lists,
+        static_cast<unsigned long long>(settings.corpus.seed)
+    );
+    if (settings.generate_only) return 0;
+
+    const std::string& path = settings.corpus_path;
+    const Work whole_file{stats.bytes, stats.records};
+
+    // records spread evenly through the file, the same ones for both lookup benchmarks
+    std::vector<size_t> targets;
+    for (size_t i = 0; i < settings.lookups && stats.records != 0; i++)
+        targets.push_back(stats.records * (2 * i + 1) / (2 * settings.lookups));
+    std::vector<std::string> target_names;
+    for (size_t target : targets)
+        target_names.push_back(pyson_bench::record_name(target, settings.corpus.name_length));
+
+    // inputs for the Value benchmarks, gathered up front so only the Value calls are timed
+    std::vector<pyson::NamedValue> values = pyson::FileReader(path).all();
+    std::vector<std::string> list_payloads;
+    size_t list_bytes = 0;
+    for (const pyson::NamedValue& value : values) {
+        if (value.value_ref().type() != pyson::PysonType::PysonList) continue;
+        std::string payload;
+        for (const std::string& element : value.value_ref().list_ref_or_throw()) {
+            if (!payload.empty()) payload += "(*)";
+            payload += element;
+        }
+        list_bytes += payload.size();
+        list_payloads.push_back(std::move(payload));
+    }
+
+    Runner runner(settings);
+
+    runner.run("FileReader::next()", [&] {
+        pyson::FileReader reader(path);
+        size_t records = 0;
+        while (reader.next().has_value()) records++;
+        sink = records;
+        return whole_file;
+    });
+
+    runner.run("FileReader::next_into()", [&] {
+        pyson::FileReader reader(path);
+        pyson::NamedValue out("", pyson::Value(0));
+        size_t records = 0;
+        while (reader.next_into(out)) records++;
+        sink = records;
+        return whole_file;
+    });
+
+    runner.run("FileReader::next_into() read-ahead", [&] {
+        pyson::FileReader reader(path);
+        reader.read_ahead();
+        pyson::NamedValue out("", pyson::Value(0));
+        size_t records = 0;
+        while (reader.next_into(out)) records++;
+        sink = records;
+        return whole_file;
+    });
+
+    runner.run("SharedFileReader::Cursor::next_into()", [&] {
+        pyson::SharedFileReader shared(path);
+        pyson::SharedFileReader::Cursor cursor = shared.cursor();
+        pyson::NamedValue value("", pyson::Value(0));
+        size_t records = 0;
+        while (cursor.next_into(value)) records++;
+        sink = records;
+        return whole_file;
+    });
+
+    runner.run("FileReader::next_lazy_into()", [&] {
+        pyson::FileReader reader(path);
+        pyson::LazyNamedValue out("", pyson::LazyValue(pyson::Value(0)));
+        size_t records = 0;
+        while (reader.next_lazy_into(out)) records++;
+        sink = records;
+        return whole_file;
+    });
+
+    runner.run("FileReader range-for", [&] {
+        pyson::FileReader reader(path);
+        size_t records = 0;
+        for (const pyson::NamedValue& value : reader) records += value.name_view().size() != 0;
+        sink = records;
+        return whole_file;
+    });
+
+    runner.run("pyson::records() generator", [&] {
+        pyson::FileReader reader(path);
+        size_t records = 0;
+        for (const pyson::NamedValue& value : pyson::records(reader)) records += value.name_view().size() != 0;
+        sink = records;
+        return whole_file;
+    });
+
+    runner.run("FileReader::all()", [&] {
+        sink = pyson::FileReader(path).all().size();
+        return whole_file;
+    });
+
+    runner.run("FileReader::all() parallel", [&] {
+        sink = pyson::FileReader(path).all(pyson::ParallelOptions{}).size();
+        return whole_file;
+    });
+
+    runner.run("FileReader::all_lazy()", [&] {
+        sink = pyson::FileReader(path).all_lazy().size();
+        return whole_file;
+    });
+
+    runner.run("FileReader::as_frozen_map()", [&] {
+        sink = pyson::FileReader(path).as_frozen_map().size();
+        return whole_file;
+    });
+
+    // the corpus loaded as if it were 8 separate files, one after another and then all at once
+    const std::vector<std::string> many_paths(8, path);
+    const Work many_files{stats.bytes * many_paths.size(), stats.records * many_paths.size()};
+
+    runner.run("FileReader::as_frozen_map() x8", [&] {
+        size_t records = 0;
+        for (const std::string& file : many_paths) records += pyson::FileReader(file).as_frozen_map().size();
+        sink = records;
+        return many_files;
+    });
+
+    runner.run("pyson::load_many() x8", [&] {
+        size_t records = 0;
+        for (const pyson::LoadResult& result : pyson::load_many(many_paths)) records += result.values.size();
+        sink = records;
+        return many_files;
+    });
+
+    runner.run("FileReader::load_columnar()", [&] {
+        sink = pyson::FileReader(path).load_columnar().size();
+        return whole_file;
+    });
+
+    runner.run("FileReader::as_hashmap()", [&] {
+        sink = pyson::FileReader(path).as_hashmap().size();
+        return whole_file;
+    });
+
+    runner.run("FileReader::as_hashmap() parallel", [&] {
+        sink = pyson::FileReader(path).as_hashmap(pyson::ParallelOptions{}).size();
+        return whole_file;
+    });
+
+    runner.run("FileReader::value_with_name()", [&] {
+        pyson::FileReader reader(path);
+        size_t found = 0;
+        for (const std::string& name : target_names)
+            found += reader.value_with_name(name).has_value();
+        if (found != target_names.size()) throw std::logic_error("value_with_name() missed a record in the benchmark");
+        return Work{0, target_names.size()};
+    });
+
+    runner.run("FileReader::go_to_line()", [&] {
+        pyson::FileReader reader(path);
+        size_t found = 0;
+        for (size_t target : targets) {
+            reader.go_to_line(target);
+            found += reader.next().has_value();
+        }
+        if (found != targets.size()) throw std::logic_error("go_to_line() missed a record in the benchmark");
+        return Work{0, targets.size()};
+    });
+
+    runner.run("FileReader::scan() of the lookup names", [&] {
+        pyson::ScanFilter filter{};
+        filter.names.insert(target_names.begin(), target_names.end());
+        pyson::FileReader reader(path);
+        sink = reader.scan(filter).size();
+        return whole_file;
+    });
+
+    // compiled up front as well, so the BinaryReader benchmarks work with any --filter
+    const std::string compiled_path = pyson::BinaryReader::compiled_path(path);
+    pyson::compile(path, compiled_path);
+    runner.run("pyson::compile()", [&] {
+        pyson::compile(path, compiled_path);
+        return whole_file;
+    });
+
+    runner.run("BinaryReader open", [&] {
+        sink = pyson::BinaryReader(compiled_path).size();
+        return Work{0, 1};
+    });
+
+    runner.run("BinaryReader::value_with_name()", [&] {
+        pyson::BinaryReader reader(compiled_path);
+        size_t found = 0;
+        for (const std::string& name : target_names)
+            found += reader.value_with_name(name).has_value();
+        if (found != target_names.size()) throw std::logic_error("value_with_name() missed a record in the benchmark");
+        return Work{0, target_names.size()};
+    });
+
+    // every name in the file looked up by string_view, the way a loaded config is queried
+    std::vector<std::string_view> lookup_names;
+    for (const pyson::NamedValue& value : values) lookup_names.push_back(value.name_ref());
+    std::unordered_map<std::string, pyson::Value> hashmap = pyson::FileReader(path).as_hashmap();
+    runner.run("unordered_map::find() by string_view", [&] {
+        size_t found = 0;
+        for (std::string_view name : lookup_names) found += hashmap.find(std::string(name)) != hashmap.end();
+        sink = found;
+        return Work{0, lookup_names.size()};
+    });
+
+    pyson::FrozenMap frozen = pyson::FileReader(path).as_frozen_map();
+    runner.run("FrozenMap::find()", [&] {
+        size_t found = 0;
+        for (std::string_view name : lookup_names) found += frozen.find(name) != nullptr;
+        sink = found;
+        return Work{0, lookup_names.size()};
+    });
+
+    pyson::LiveConfigOptions live_options{};
+    live_options.check_interval = std::chrono::milliseconds(0);
+    pyson::LiveConfig live(path, live_options);
+    runner.run("LiveConfig::Reader::find()", [&] {
+        pyson::LiveConfig::Reader reader = live.reader();
+        size_t found = 0;
+        for (std::string_view name : lookup_names) found += reader.find(name) != nullptr;
+        sink = found;
+        return Work{0, lookup_names.size()};
+    });
+
+    // the same aggregate pass (int sum, float min/max, count per type) over both layouts
+    pyson::ColumnarTable table = pyson::FileReader(path).load_columnar();
+    runner.run("aggregate over vector<NamedValue>", [&] {
+        long long sum = 0;
+        double low = 0, high = 0;
+        size_t counts[5] = {};
+        for (const pyson::NamedValue& value : values) {
+            const pyson::Value& v = value.value_ref();
+            counts[static_cast<size_t>(v.type())]++;
+            if (v.is_int()) sum += v.int_or_throw();
+            else if (v.is_float()) {
+                low = std::min(low, v.float_or_throw());
+                high = std::max(high, v.float_or_throw());
+            }
+        }
+        sink = static_cast<size_t>(sum) + static_cast<size_t>(high - low) + counts[4];
+        return Work{0, values.size()};
+    });
+
+    runner.run("aggregate over ColumnarTable", [&] {
+        long long sum = 0;
+        for (int number : table.ints()) sum += number;
+        double low = 0, high = 0;
+        for (double number : table.floats()) {
+            low = std::min(low, number);
+            high = std::max(high, number);
+        }
+        sink = static_cast<size_t>(sum) + static_cast<size_t>(high - low)
+            + table.count(pyson::PysonType::PysonList);
+        return Work{0, table.size()};
+    });
+
+    runner.run("Value::from_pyson_list()", [&] {
+        size_t elements = 0;
+        for (const std::string& payload : list_payloads)
+            elements += pyson::Value::from_pyson_list(payload).list_span_or().size();
+        sink = elements;
+        return Work{list_bytes, list_payloads.size()};
+    });
+
+    runner.run("Value::value_as_string()", [&] {
+        size_t bytes = 0;
+        for (const pyson::NamedValue& value : values)
+            bytes += value.value_ref().value_as_string().size();
+        sink = bytes;
+        return Work{bytes, values.size()};
+    });
+
+    runner.run("NamedValue::serialize_to()", [&] {
+        std::string dump;
+        for (const pyson::NamedValue& value : values) {
+            value.serialize_to(dump);
+            dump.push_back('\n');
+        }
+        sink = dump.size();
+        return Work{dump.size(), values.size()};
+    });
+
+    if (!settings.keep_corpus) {
+        std::error_code ignored;
+        std::filesystem::remove(path, ignored);
+        std::filesystem::remove(compiled_path, ignored);
+    }
+}
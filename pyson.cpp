@@ -1,13 +1,173 @@
 #include "pyson.hpp"
 #include <iterator>
 #include <cstring>
-#include <sstream>
 #include <new>
 #include <limits>
 #include <iostream>
+#include <charconv>
+#include <cstdint>
+#include <algorithm>
+#include <thread>
+#include <exception>
+#include <system_error>
+#include <filesystem>
+#include <fstream>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <climits>
+#include <random>
+
+// x86 vector kernels for StructuralIndex, SSE2 is always there on x86-64
+#if defined(__x86_64__) || defined(_M_X64)
+#define PYSON_X86_SIMD 1
+#include <emmintrin.h>
+#else
+#define PYSON_X86_SIMD 0
+#endif
+// AVX2 is chosen at runtime, which needs the GCC/Clang target attribute
+#if PYSON_X86_SIMD && (defined(__GNUC__) || defined(__clang__))
+#define PYSON_X86_AVX2 1
+#include <immintrin.h>
+#else
+#define PYSON_X86_AVX2 0
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#if POSIX_FUNCTIONS_AVAILABLE
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <poll.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
 
 namespace pyson {
 
+namespace {
+
+// Where the two colons of a pyson line are
+struct LineSplit {
+    size_t first_colon;
+    size_t second_colon;
+};
+
+// Find both colons of a line in a single pass, returns false if there aren't two
+bool split_line(const char *line, size_t length, LineSplit& out) noexcept {
+    const char *first = static_cast<const char *>(std::memchr(line, ':', length));
+    if (first == nullptr) return false;
+    size_t first_colon = static_cast<size_t>(first - line);
+    const char *second = static_cast<const char *>(
+        std::memchr(first + 1, ':', length - first_colon - 1)
+    );
+    if (second == nullptr) return false;
+    out.first_colon = first_colon;
+    out.second_colon = static_cast<size_t>(second - line);
+    return true;
+}
+
+// Turn "int", "float", "str" or "list" into a PysonType
+bool parse_type_tag(const char *tag, size_t length, PysonType& out) noexcept {
+    switch (length) {
+        case 3: switch (tag[0]) {
+            case 'i': out = PysonType::PysonInt; return tag[1] == 'n' && tag[2] == 't';
+            case 's': out = PysonType::PysonStr; return tag[1] == 't' && tag[2] == 'r';
+            default: return false;
+        }
+        case 4: out = PysonType::PysonList; return std::memcmp(tag, "list", 4) == 0;
+        case 5: out = PysonType::PysonFloat; return std::memcmp(tag, "float", 5) == 0;
+        default: return false;
+    }
+}
+
+// Skip what std::stoi/std::stod would skip before the number
+const char *skip_number_prefix(const char *first, const char *last) noexcept {
+    while (first != last && (*first == ' ' || (*first >= '\t' && *first <= '\r'))) first++;
+    if (first != last && *first == '+' && (last - first == 1 || first[1] != '-')) first++;
+    return first;
+}
+
+// Convert like std::stoi, but without the locale or exceptions
+bool parse_int(const char *payload, size_t length, int& out) noexcept {
+    const char *last = payload + length;
+    std::from_chars_result res = std::from_chars(skip_number_prefix(payload, last), last, out);
+    return res.ec == std::errc{};
+}
+
+// Convert like std::stod, but without the locale or exceptions
+bool parse_float(const char *payload, size_t length, double& out) noexcept {
+    const char *last = payload + length;
+    std::from_chars_result res = std::from_chars(skip_number_prefix(payload, last), last, out);
+    return res.ec == std::errc{};
+}
+
+// The type tag of a PysonType, as it's written in a file
+const char *type_name(PysonType type) noexcept {
+    switch (type) {
+        case PysonType::PysonInt: return "int";
+        case PysonType::PysonFloat: return "float";
+        case PysonType::PysonStr: return "str";
+        case PysonType::PysonList: return "list";
+    }
+    return "unknown";
+}
+
+// Big enough for any int, and for any double in its shortest form
+constexpr size_t number_chars = 32;
+
+// Format a number like pyson writes it (a double in the shortest form that reads back exactly), returns the length
+template <class Number>
+size_t format_number(Number number, char (&chars)[number_chars]) noexcept {
+    return static_cast<size_t>(std::to_chars(chars, chars + number_chars, number).ptr - chars);
+}
+
+// Call `element` with each element of a pyson list, in order
+template <class Element>
+void for_each_list_element(std::string_view pyson_list, Element element) {
+    size_t token_start = 0;
+    // a separator only counts if something comes before it in the element
+    for (size_t sep = pyson_list.find("(*)", 1); sep != std::string_view::npos; sep = pyson_list.find("(*)", token_start + 1)) {
+        element(pyson_list.substr(token_start, sep - token_start));
+        token_start = sep + 3;
+    }
+    element(pyson_list.substr(token_start));
+}
+
+// Split a pyson list into `list`, reusing the strings already in it
+void split_pyson_list(std::string_view pyson_list, std::vector<std::string>& list) {
+    size_t count = 0;
+    for_each_list_element(pyson_list, [&](std::string_view element) {
+        if (count < list.size()) list[count].assign(element);
+        else list.emplace_back(element);
+        count++;
+    });
+    list.resize(count);
+}
+
+// Find the colons of a line and parse it
+bool parse_unsplit_line(const char *line, size_t length, NamedValue& out, SpareStorage& spare) {
+    LineSplit split;
+    if (!split_line(line, length, split)) return false;
+    return parse_line(line, length, split.first_colon, split.second_colon, out, spare);
+}
+
+// Parse a line into whichever kind of record FileReader::read_next() is reading
+bool parse_record(const char *line, size_t length, NamedValue& out, SpareStorage& spare) {
+    return parse_unsplit_line(line, length, out, spare);
+}
+bool parse_record(const char *line, size_t length, LazyNamedValue& out, SpareStorage&) {
+    return LazyNamedValue::from_line(std::string_view(line, length), out);
+}
+
+}
+
 const char *WrongPysonType::what() const noexcept {
     switch (m_got) {
         case PysonType::PysonInt: switch (m_expected) {
@@ -69,7 +229,11 @@ bool Value::operator== (const Value& other) const noexcept {
 
 // makes a Value printable
 std::ostream& operator<< (std::ostream& o, const Value& val) {
-    o << val.type_cstring() << ':' << val.value_as_string();
+    // one write to the stream, instead of one per piece
+    std::string formatted(val.type_cstring());
+    formatted.push_back(':');
+    val.serialize_to(formatted);
+    o.write(formatted.data(), static_cast<std::streamsize>(formatted.size()));
     return o;
 }
 
@@ -93,7 +257,7 @@ Value::Value(const Value& other) : m_value(0) {
     }
 }
 // Value move constructor
-Value::Value(Value&& other) : m_value(0) {
+Value::Value(Value&& other) noexcept : m_value(0) {
     // (same code as copy constructor)
     switch (other.type()) {
         case PysonType::PysonInt:
@@ -134,7 +298,7 @@ Value& Value::operator= (const Value& other) {
     return *this;
 }
 // Value move assignment
-Value& Value::operator= (Value&& other) {
+Value& Value::operator= (Value&& other) noexcept {
     this->~Value();
     switch (other.type()) {
         case PysonType::PysonInt:
@@ -157,57 +321,106 @@ Value& Value::operator= (Value&& other) {
 
 // Returns "int", "float", "str", or "list"
 const char *Value::type_cstring() const noexcept {
-    switch (type()) {
-        case PysonType::PysonInt: return "int";
-        case PysonType::PysonFloat: return "float";
-        case PysonType::PysonStr: return "str";
-        case PysonType::PysonList: return "list";
-    }
+    return type_name(type());
 }
 
 // Turn the Value's value into a pyson-formatted string
 std::string Value::value_as_string() const noexcept {
+    std::string str;
+    serialize_to(str);
+    return str;
+}
+
+size_t Value::serialized_size() const noexcept {
+    char digits[number_chars];
     switch (type()) {
-        case PysonType::PysonInt: return std::to_string(m_value.m_int);
-        case PysonType::PysonFloat: return std::to_string(m_value.m_float);
-        case PysonType::PysonStr: return m_value.m_str;
+        case PysonType::PysonInt: return format_number(m_value.m_int, digits);
+        case PysonType::PysonFloat: return format_number(m_value.m_float, digits);
+        case PysonType::PysonStr: return m_value.m_str.size();
         case PysonType::PysonList: {
-            std::ostringstream pyson_list;
-            if (m_value.m_list.empty()) return "";
-            std::copy(
-                m_value.m_list.begin(),
-                m_value.m_list.end(),
-                std::ostream_iterator<std::string>(pyson_list, "(*)")
-            );
-            std::string str = pyson_list.str();
-            str.pop_back();
-            str.pop_back();
-            str.pop_back();
-            return str;
+            const std::vector<std::string>& list = m_value.m_list;
+            if (list.empty()) return 0;
+            // a "(*)" between each pair of elements
+            size_t size = 3 * (list.size() - 1);
+            for (const std::string& element : list) size += element.size();
+            return size;
         }
     }
+    return 0;
 }
 
-// Create a Value from a list in the pyson format
-Value Value::from_pyson_list(std::string pyson_list) {
-    Value result(std::vector<std::string>{});
-    std::string current_token{};
-    for (char c : pyson_list) {
-        current_token.push_back(c);
-        size_t size = current_token.length();
-        if (size > 3 && current_token.substr(size-3, 3) == "(*)") {
-            result.m_value.m_list.push_back(current_token.substr(0, size-3));
-            current_token.clear();
+char *Value::serialize_to(char *out) const noexcept {
+    char digits[number_chars];
+    switch (type()) {
+        case PysonType::PysonInt: {
+            size_t length = format_number(m_value.m_int, digits);
+            std::memcpy(out, digits, length);
+            return out + length;
+        }
+        case PysonType::PysonFloat: {
+            size_t length = format_number(m_value.m_float, digits);
+            std::memcpy(out, digits, length);
+            return out + length;
+        }
+        case PysonType::PysonStr:
+            std::memcpy(out, m_value.m_str.data(), m_value.m_str.size());
+            return out + m_value.m_str.size();
+        case PysonType::PysonList: {
+            const std::vector<std::string>& list = m_value.m_list;
+            for (size_t i = 0; i < list.size(); i++) {
+                if (i != 0) {
+                    std::memcpy(out, "(*)", 3);
+                    out += 3;
+                }
+                std::memcpy(out, list[i].data(), list[i].size());
+                out += list[i].size();
+            }
+            return out;
         }
     }
-    result.m_value.m_list.push_back(current_token);
+    return out;
+}
+
+void Value::serialize_to(std::string& out) const {
+    switch (type()) {
+        case PysonType::PysonInt: {
+            char digits[number_chars];
+            out.append(digits, format_number(m_value.m_int, digits));
+            return;
+        }
+        case PysonType::PysonFloat: {
+            char digits[number_chars];
+            out.append(digits, format_number(m_value.m_float, digits));
+            return;
+        }
+        case PysonType::PysonStr:
+            out.append(m_value.m_str);
+            return;
+        case PysonType::PysonList: {
+            // grow the string once for the whole list, then copy the elements in
+            size_t start = out.size();
+            out.resize(start + serialized_size());
+            serialize_to(out.data() + start);
+            return;
+        }
+    }
+}
+
+// Create a Value from a list in the pyson format
+Value Value::from_pyson_list(std::string_view pyson_list) {
+    Value result(std::vector<std::string>{});
+    split_pyson_list(pyson_list, result.m_value.m_list);
     return result;
 }
 
 void Value::force_to_string() noexcept {
     switch(type()) {
         case PysonType::PysonStr: return;
-        default: *this = Value(value_as_string());
+        default: {
+            std::string str;
+            serialize_to(str);
+            *this = Value(std::move(str));
+        }
     }
 }
 
@@ -224,335 +437,3194 @@ void Value::force_to_list() noexcept {
 }
 
 // Output a NamedValue in the pyson format
-std::ostream& operator<< (std::ostream& o, NamedValue& v) {
-    o << v.m_name << ':' << v.m_value;
+std::ostream& operator<< (std::ostream& o, const NamedValue& v) {
+    std::string line;
+    v.serialize_to(line);
+    o.write(line.data(), static_cast<std::streamsize>(line.size()));
     return o;
 }
 
-// Read a pyson-formatted line into a NamedValue
-bool operator>> (std::istream& i, NamedValue& v) {
-    std::string current_token{};
-    std::getline(i, current_token, ':');
-    for (char c : current_token) if (c == '\n') return false;
-    v.change_name(current_token);
-
-    std::getline(i, current_token, ':');
-    if (current_token == "int") { v.m_value.m_type = PysonType::PysonInt; }
-    else if (current_token == "float") { v.m_value.m_type = PysonType::PysonFloat; }
-    else if (current_token == "str") { v.m_value = Value(""); }
-    else if (current_token == "list") { v.m_value = Value(std::vector<std::string>{}); }
-    else { return false; }
-
-    std::getline(i, current_token);
-    switch (v.m_value.type()) {
-        case PysonType::PysonInt:
-            try { v.m_value = Value(std::stoi(current_token)); break; }
-            catch (...) { return false; }
-        case PysonType::PysonFloat:
-            try { v.m_value = Value(std::stod(current_token)); break; }
-            catch(...) { return false; }
-        case PysonType::PysonStr: v.m_value = Value(current_token); break;
-        case PysonType::PysonList: v.m_value = Value::from_pyson_list(current_token); break;
+void NamedValue::serialize_to(std::string& out) const {
+    const char *type = m_value.type_cstring();
+    size_t type_length = std::strlen(type);
+    if (m_value.type() == PysonType::PysonStr || m_value.type() == PysonType::PysonList) {
+        // the size of the whole line is known up front, so the string only grows once
+        size_t start = out.size();
+        out.resize(start + m_name.size() + 1 + type_length + 1 + m_value.serialized_size());
+        char *cursor = out.data() + start;
+        std::memcpy(cursor, m_name.data(), m_name.size());
+        cursor += m_name.size();
+        *cursor++ = ':';
+        std::memcpy(cursor, type, type_length);
+        cursor += type_length;
+        *cursor++ = ':';
+        m_value.serialize_to(cursor);
+        return;
     }
-    return true;
+    out.reserve(out.size() + m_name.size() + 1 + type_length + 1 + number_chars);
+    out.append(m_name);
+    out.push_back(':');
+    out.append(type, type_length);
+    out.push_back(':');
+    m_value.serialize_to(out);
 }
 
-#if POSIX_FUNCTIONS_AVAILABLE
-FileReader::FileReader(const char *path) : m_handle(fopen(path, "r")) {
-    if (errno != 0) {
-        throw std::runtime_error(
-            "fopen() IO error code "
-            + std::to_string(errno)
-            + " in FileReader::FileReader(const char *path)"
-        );
-    }
-}
-FileReader::FileReader(const std::string& path) : m_handle(fopen(path.c_str(), "r")) {
-    if (errno != 0) {
-        throw std::runtime_error(
-            "fopen() IO error code "
-            + std::to_string(errno)
-            + " in FileReader::FileReader(const std::string& path)"
-        );
-    }
+// Parse one pyson line (without the newline) into a NamedValue
+bool parse_line(const char *line, size_t length, NamedValue& out) {
+    SpareStorage spare;
+    return parse_unsplit_line(line, length, out, spare);
 }
 
-std::optional<NamedValue> FileReader::next() {
-    char *line = nullptr;
-    size_t s{};
-    ssize_t len = getline(&line, &s, m_handle);
-    if (len == -1) return std::nullopt;
-    
-    
-    std::istringstream str(std::string(line, len));
-    free((void*)line);
-    NamedValue result("", Value(0));
-    
-    if (str >> result) return result;
-    else throw std::runtime_error("Invalid pyson value encountered in FileReader::next()");
+// Parse one pyson line whose colons have already been found
+bool parse_line(const char *line, size_t length, size_t first_colon, size_t second_colon, NamedValue& out) {
+    SpareStorage spare;
+    return parse_line(line, length, first_colon, second_colon, out, spare);
 }
-NamedValue FileReader::next_or(const NamedValue& default_val) {
-    char *line = nullptr;
-    size_t s{};
-    ssize_t len = getline(&line, &s, m_handle);
-    if (len == -1) return default_val;
 
-    std::istringstream str(std::string(line, len));
-    free((void*)line);
-    NamedValue result("", Value(0));
-    if (str >> result) return result;
-    else throw std::runtime_error("Invalid pyson value encountered in FileReader::next_or()");
-}
-NamedValue FileReader::next_or(NamedValue&& default_val) {
-    char *line = nullptr;
-    size_t s{};
-    ssize_t len = getline(&line, &s, m_handle);
-    if (len == -1) return std::move(default_val);
+// Parse one pyson line whose colons have already been found, moving storage in and out of `spare`
+bool parse_line(
+    const char *line,
+    size_t length,
+    size_t first_colon,
+    size_t second_colon,
+    NamedValue& out,
+    SpareStorage& spare
+) {
+    if (first_colon >= second_colon || second_colon >= length) return false;
 
-    std::istringstream str(std::string(line, len));
-    NamedValue result("", Value(0));
-    if (str >> result) return result;
-    else throw std::runtime_error("Invalid pyson value encountered in FileReader::next_or()");
+    PysonType type;
+    const char *tag = line + first_colon + 1;
+    if (!parse_type_tag(tag, second_colon - first_colon - 1, type)) return false;
+
+    const char *payload = line + second_colon + 1;
+    size_t payload_length = length - second_colon - 1;
+    Value& value = out.m_value;
+    // hand the old string or list to `spare` before the value stops being one
+    auto give_back = [&]() {
+        if (value.is_str()) spare.str.swap(value.m_value.m_str);
+        else if (value.is_list()) spare.list.swap(value.m_value.m_list);
+    };
+
+    switch (type) {
+        case PysonType::PysonInt: {
+            int val;
+            if (!parse_int(payload, payload_length, val)) return false;
+            give_back();
+            value = Value(val);
+            break;
+        }
+        case PysonType::PysonFloat: {
+            double val;
+            if (!parse_float(payload, payload_length, val)) return false;
+            give_back();
+            value = Value(val);
+            break;
+        }
+        case PysonType::PysonStr:
+            if (!value.is_str()) {
+                give_back();
+                value = Value(std::string{});
+                value.m_value.m_str.swap(spare.str);
+            }
+            value.m_value.m_str.assign(payload, payload_length);
+            break;
+        case PysonType::PysonList:
+            if (!value.is_list()) {
+                give_back();
+                value = Value(std::vector<std::string>{});
+                value.m_value.m_list.swap(spare.list);
+            }
+            split_pyson_list(std::string_view(payload, payload_length), value.m_value.m_list);
+            break;
+    }
+    out.m_name.assign(line, first_colon);
+    return true;
 }
-NamedValue FileReader::next_or_throw() {
-    char *line = nullptr;
-    size_t s{};
-    ssize_t len = getline(&line, &s, m_handle);
-    if (len == -1)
-        throw std::runtime_error("EOF encountered in FileReader::next_or()");
-
-    std::istringstream str(std::string(line, len));
-    free((void*)line);
-    NamedValue result("", Value(0));
-    if (str >> result) return result;
-    else throw std::runtime_error("Invalid pyson value encountered in FileReader::next_or_throw()");
+
+// Read a pyson-formatted line into a NamedValue
+bool operator>> (std::istream& i, NamedValue& v) {
+    std::string line{};
+    if (!std::getline(i, line)) return false;
+    return parse_line(line.data(), line.size(), v);
 }
 
-void FileReader::go_to_beginning() { rewind(m_handle); }
-void FileReader::go_to_line(size_t line_number) {
-    go_to_beginning();
-    if (line_number == 0) return;
-    
-    char *line = nullptr;
-    size_t len = 0;
-    for (size_t i = 0; i < line_number; i++) {
-        if (-1 != getline(&line, &len, m_handle)) continue;
-        free((void*)line);
-        throw std::runtime_error("File ended before requested line in FileReader::go_to_line()");
+namespace {
+
+// Records newlines and colons into a StructuralIndex, in the order they appear in the buffer
+class IndexBuilder {
+    StructuralIndex& m_index;
+    size_t m_size;
+
+public:
+    IndexBuilder(StructuralIndex& index, size_t size) : m_index(index), m_size(size) {
+        if (size != 0) start_line(0);
     }
-    free((void*)line);
-}
-void FileReader::skip_n_lines(size_t amount_to_skip) {
-    if (amount_to_skip == 0) return;
-    
-    char *line = nullptr;
-    size_t len = 0;
-    for (size_t i = 0; i < amount_to_skip; i++) {
-        if (-1 != getline(&line, &len, m_handle)) continue;
-        free((void*)line);
-        throw std::runtime_error("File ended before requested line in FileReader::skip_n_lines()");
+
+    void start_line(size_t position) {
+        m_index.line_starts.push_back(position);
+        m_index.first_colons.push_back(StructuralIndex::npos);
+        m_index.second_colons.push_back(StructuralIndex::npos);
     }
-    free((void*)line);
-}
 
-std::vector<NamedValue> FileReader::all() {
-    go_to_beginning();
-    char *line = nullptr;
-    size_t len = 0;
-    std::vector<NamedValue> values{};
-    NamedValue next("", Value(0));
-    
-    while (-1 != getline(&line, &len, m_handle)) {
-        std::istringstream str(std::string(line, len));
-        if (str >> next) values.push_back(next);
-        else {
-            free((void*)line);
-            throw std::runtime_error("Invalid pyson value encountered in FileReader::all()");
+    void newline(size_t position) {
+        m_index.line_ends.push_back(position);
+        if (position + 1 < m_size) start_line(position + 1);
+    }
+
+    void colon(size_t position) noexcept {
+        if (m_index.first_colons.back() == StructuralIndex::npos) m_index.first_colons.back() = position;
+        else if (m_index.second_colons.back() == StructuralIndex::npos) m_index.second_colons.back() = position;
+    }
+
+    void finish() {
+        if (m_index.line_ends.size() < m_index.line_starts.size()) m_index.line_ends.push_back(m_size);
+    }
+
+    // Handle every set bit of a block's masks, lowest (earliest) first
+    void consume_masks(size_t base, uint32_t newlines, uint32_t colons) {
+        uint32_t both = newlines | colons;
+        while (both != 0) {
+            unsigned bit = count_trailing_zeros(both);
+            if (newlines & (uint32_t(1) << bit)) newline(base + bit);
+            else colon(base + bit);
+            both &= both - 1;
         }
     }
 
-    free((void*)line);
-    return values;
+    static unsigned count_trailing_zeros(uint32_t mask) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long bit;
+        _BitScanForward(&bit, mask);
+        return static_cast<unsigned>(bit);
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+};
+
+// Plain byte-by-byte scan, also used for what's left after the vector kernels
+void scan_scalar(const char *data, size_t start, size_t size, IndexBuilder& builder) {
+    for (size_t i = start; i < size; i++) {
+        if (data[i] == '\n') builder.newline(i);
+        else if (data[i] == ':') builder.colon(i);
+    }
 }
 
-#else // windows
-FileReader::FileReader(const char *path) : m_stream() {
-    m_stream.open(path);
-    if (!m_stream.good()) {
-        throw std::runtime_error(
-            "Error opening file in FileReader::FileReader(const char *path)"
-        );
+#if PYSON_X86_SIMD
+void scan_sse2(const char *data, size_t size, IndexBuilder& builder) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i colon = _mm_set1_epi8(':');
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        uint32_t newlines = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+        uint32_t colons = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, colon)));
+        if ((newlines | colons) != 0) builder.consume_masks(i, newlines, colons);
     }
+    scan_scalar(data, i, size, builder);
 }
-FileReader::FileReader(const std::string& path) : m_stream() {
-    m_stream.open(path.c_str());
-    if (!m_stream.good()) {
-        throw std::runtime_error(
-            "Error opening file in FileReader::FileReader(const std::string& path)"
-        );
+#endif
+
+#if PYSON_X86_AVX2
+__attribute__((target("avx2")))
+void scan_avx2(const char *data, size_t size, IndexBuilder& builder) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i colon = _mm256_set1_epi8(':');
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        uint32_t newlines = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+        uint32_t colons = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, colon)));
+        if ((newlines | colons) != 0) builder.consume_masks(i, newlines, colons);
     }
+    scan_scalar(data, i, size, builder);
 }
+#endif
 
-std::optional<NamedValue> FileReader::next() {
-    NamedValue v("", Value(0));
-    if (m_stream >> v) return v;
-    else return std::nullopt;
+using ScanKernel = void (*)(const char *, size_t, IndexBuilder&);
+
+#if !PYSON_X86_SIMD
+void scan_scalar_kernel(const char *data, size_t size, IndexBuilder& builder) {
+    scan_scalar(data, 0, size, builder);
 }
-NamedValue FileReader::next_or(const NamedValue& default_value) {
-    NamedValue v("", Value(0));
-    if (m_stream >> v) return v;
-    else return default_value;
+#endif
+
+// Pick the widest kernel this CPU supports, checked once
+struct SelectedKernel {
+    ScanKernel scan;
+    const char *name;
+};
+const SelectedKernel& selected_kernel() noexcept {
+    static const SelectedKernel kernel = []() -> SelectedKernel {
+#if PYSON_X86_AVX2
+        if (__builtin_cpu_supports("avx2")) return {scan_avx2, "avx2"};
+#endif
+#if PYSON_X86_SIMD
+        return {scan_sse2, "sse2"};
+#else
+        return {scan_scalar_kernel, "scalar"};
+#endif
+    }();
+    return kernel;
 }
-NamedValue FileReader::next_or(NamedValue&& default_value) {
-    NamedValue v("", Value(0));
-    if (m_stream >> v) return v;
-    else return std::move(default_value);
+
 }
-NamedValue FileReader::next_or_throw() {
-    NamedValue v("", Value(0));
-    if (m_stream >> v) return v;
-    else throw std::runtime_error("Invalid pyson value encountered in FileReader::next_or_throw");
+
+// Find every newline and the first two colons of every line
+StructuralIndex StructuralIndex::build(const char *data, size_t size) {
+    StructuralIndex index;
+    IndexBuilder builder(index, size);
+    selected_kernel().scan(data, size, builder);
+    builder.finish();
+    return index;
 }
 
-void FileReader::go_to_beginning() {
-    m_stream.clear();
-    m_stream.seekg(0);
+const char *StructuralIndex::kernel_name() noexcept { return selected_kernel().name; }
+
+namespace {
+
+// Parse line number i of a buffer using its StructuralIndex
+bool parse_indexed_line(const char *data, const StructuralIndex& index, size_t i, NamedValue& out) {
+    if (index.second_colons[i] == StructuralIndex::npos) return false;
+    size_t start = index.line_starts[i];
+    return parse_line(
+        data + start,
+        index.line_ends[i] - start,
+        index.first_colons[i] - start,
+        index.second_colons[i] - start,
+        out
+    );
 }
-void FileReader::go_to_line(size_t line_number) {
-    go_to_beginning();
-    for (size_t i = 0; i < line_number; i++) {
-        if (m_stream.eof())
-            throw std::runtime_error("File ended before requested line in FileReader::go_to_line()");
-        m_stream.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+// Parse every line of a buffer onto the end of a vector
+void parse_buffer(std::string_view buffer, std::vector<NamedValue>& values, const char *invalid_message) {
+    StructuralIndex index = StructuralIndex::build(buffer.data(), buffer.size());
+    values.reserve(values.size() + index.line_count());
+    NamedValue next("", Value(0));
+    for (size_t i = 0; i < index.line_count(); i++) {
+        if (!parse_indexed_line(buffer.data(), index, i, next))
+            throw std::runtime_error(invalid_message);
+        values.push_back(std::move(next));
     }
 }
-void FileReader::skip_n_lines(size_t amount_to_skip) {
-    for (size_t i = 0; i < amount_to_skip; i++) {
-        if (m_stream.eof())
-            throw std::runtime_error("File ended before skipping enough lines in FileReader::skip_n_lines");
-        m_stream.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+// Parse every line of a buffer into a map, names must not already be in the map
+void parse_buffer(
+    std::string_view buffer,
+    std::unordered_map<std::string, Value>& map,
+    const char *invalid_message,
+    const char *duplicate_message
+) {
+    StructuralIndex index = StructuralIndex::build(buffer.data(), buffer.size());
+    map.reserve(map.size() + index.line_count());
+    NamedValue next("", Value(0));
+    for (size_t i = 0; i < index.line_count(); i++) {
+        if (!parse_indexed_line(buffer.data(), index, i, next))
+            throw std::runtime_error(invalid_message);
+        if (!map.try_emplace(std::move(next).name(), std::move(next).value()).second)
+            throw std::runtime_error(duplicate_message);
     }
 }
 
-std::vector<NamedValue> FileReader::all() {
-    go_to_beginning();
-    std::vector<NamedValue> values{};
-    NamedValue next("", Value(0));
-    while (m_stream >> next)
-        values.push_back(next);
+// Split a buffer into about one chunk per thread, each ending right after a newline
+std::vector<std::string_view> split_into_chunks(std::string_view buffer, ParallelOptions options) {
+    size_t threads = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+    size_t by_size = buffer.size() / std::max<size_t>(options.min_chunk_size, 1);
+    size_t count = std::max<size_t>(std::min(threads, by_size), 1);
+    size_t target = buffer.size() / count;
 
-    if (m_stream.eof()) return values;
-    else throw std::runtime_error("Invalid pyson value encountered in FileReader::all()");
-}
-#endif // functions that work for both
-std::unordered_map<std::string, Value> FileReader::as_hashmap() {
-    go_to_beginning();
-    std::unordered_map<std::string, Value> map;
-    for (std::optional<NamedValue> current = next(); current.has_value(); current = next()) {
-        NamedValue& cref = current.value();
-        if (map.contains(cref.name()))
-            throw std::runtime_error("Duplicate name encountered in FileReader::as_hashmap()");
-        map.insert(std::make_pair(cref.name(), cref.value()));
+    std::vector<std::string_view> chunks;
+    size_t start = 0;
+    for (size_t i = 1; i < count && start < buffer.size(); i++) {
+        size_t newline = buffer.find('\n', std::max(start, i * target));
+        if (newline == std::string_view::npos) break;
+        chunks.push_back(buffer.substr(start, newline + 1 - start));
+        start = newline + 1;
     }
-    return map;
+    if (start < buffer.size()) chunks.push_back(buffer.substr(start));
+    return chunks;
 }
 
-std::optional<Value> FileReader::value_with_name(const char *name) {
-    go_to_beginning();
-    for (std::optional<NamedValue> current = next(); current.has_value(); current = next()) {
-        if (current.value().name() == name)
-            return current.value().value();
+// Call work(i) for every i in [0, count) on its own thread, then rethrow the first failure
+template <class Work>
+void run_on_threads(size_t count, Work work) {
+    if (count == 0) return;
+    std::vector<std::exception_ptr> errors(count);
+    auto guarded = [&](size_t i) {
+        try { work(i); }
+        catch (...) { errors[i] = std::current_exception(); }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(count);
+    for (size_t i = 1; i < count; i++) {
+        try { threads.emplace_back(guarded, i); }
+        catch (const std::system_error&) { guarded(i); } // out of threads, just do it here
     }
-    return std::nullopt;
-}
+    guarded(0);
+    for (std::thread& thread : threads) thread.join();
 
-void FileReader::for_each(std::function<void (NamedValue)> predicate) {
-    for (auto v = next(); v != std::nullopt; v = next())
-        predicate(v.value());
+    for (std::exception_ptr& error : errors)
+        if (error) std::rethrow_exception(error);
 }
 
-template <class Return>
-std::vector<Return> FileReader::map_each(std::function<Return (NamedValue)> predicate) {
-    auto vec = std::vector<Return>{};
-    for (auto v = next(); v != std::nullopt; v = next())
-        vec.push_back(predicate(v));
-    return vec;
-}
+#if PYSON_STATS
+// Adds the time until it goes out of scope to a ReaderStats duration
+class StatsTimer {
+    std::chrono::nanoseconds& m_total;
+    std::chrono::steady_clock::time_point m_start;
+public:
+    explicit StatsTimer(std::chrono::nanoseconds& total) noexcept
+        : m_total(total), m_start(std::chrono::steady_clock::now()) {}
+    ~StatsTimer() noexcept { m_total += std::chrono::steady_clock::now() - m_start; }
+};
 
-void FileReader::for_each_while(std::function<bool (NamedValue)> predicate) {
-    for (auto v = next(); v != std::nullopt && predicate(v.value()); v = next())
-        ; // no loop body
-}
+// Times a whole-file parse, and counts it as failed if it ends with an exception
+class StatsParse {
+    ReaderStats& m_stats;
+    StatsTimer m_timer;
+    int m_exceptions;
+public:
+    explicit StatsParse(ReaderStats& stats) noexcept
+        : m_stats(stats), m_timer(stats.parse_time), m_exceptions(std::uncaught_exceptions()) {}
+    ~StatsParse() noexcept { if (std::uncaught_exceptions() > m_exceptions) m_stats.parse_failures++; }
+};
 
-template <class Return>
-std::vector<Return> FileReader::map_while(std::function<std::pair<bool, Return> (NamedValue)> predicate) {
-    auto vec = std::vector<Return>{};
-    for (auto val = next(); val != std::nullopt; val = next()) {
-        auto res = predicate(val);
-        if (!res.first) return vec;
-        else vec.push_back(res.second);
+// Reports the stats to the sink when it goes out of scope
+template <class State>
+class StatsReport {
+    const State& m_state;
+public:
+    explicit StatsReport(const State& state) noexcept : m_state(state) {}
+    ~StatsReport() noexcept { m_state.report(); }
+};
+
+void count_type(ReaderStats& stats, PysonType type) noexcept {
+    switch (type) {
+        case PysonType::PysonInt: stats.ints++; break;
+        case PysonType::PysonFloat: stats.floats++; break;
+        case PysonType::PysonStr: stats.strs++; break;
+        case PysonType::PysonList: stats.lists++; break;
     }
-    return vec;
 }
 
-template <class Return>
-std::vector<Return> FileReader::map_while(std::function<std::optional<Return> (NamedValue)> predicate) {
-    auto vec = std::vector<Return>{};
-    for (auto val = next(); val != std::nullopt; val = next()) {
-        auto res = predicate(val);
-        if (!res.has_value()) return vec;
-        else vec.push_back(res.value());
-    }
-    return vec;
+// Count everything a whole-file parse produced
+void count_parsed(ReaderStats& stats, const std::vector<NamedValue>& values) noexcept {
+    stats.lines_parsed += values.size();
+    for (const NamedValue& value : values) count_type(stats, value.value_ref().type());
 }
+void count_parsed(ReaderStats& stats, const std::unordered_map<std::string, Value>& map) noexcept {
+    stats.lines_parsed += map.size();
+    for (const auto& [name, value] : map) count_type(stats, value.type());
+}
+void count_parsed(ReaderStats& stats, const Document& document) noexcept {
+    stats.lines_parsed += document.size();
+    for (size_t i = 0; i < document.size(); i++) count_type(stats, document.value(i).type());
+}
+#endif
 
-FileReader::Iter::Iter(FileReader *reader) : m_reader(reader), m_cached("", Value(0)) {
-    if (m_reader == nullptr)
-        return;
-    auto opt = m_reader->next();
-    if (opt == std::nullopt) {
-        m_reader = nullptr;
-        return;
-    }
-    m_cached = opt.value();
 }
 
-FileReader::End FileReader::end() { return End{}; }
+// Counting for ReaderStats, these all compile to nothing unless PYSON_STATS is enabled
+#if PYSON_STATS
+#define PYSON_COUNT(counter, amount) (m_stats.stats.counter += (amount))
+#define PYSON_COUNT_TYPE(type) count_type(m_stats.stats, (type))
+#define PYSON_TIME(duration) StatsTimer pyson_stats_timer(m_stats.stats.duration)
+#define PYSON_TIME_PARSE() StatsParse pyson_stats_parse(m_stats.stats)
+#define PYSON_COUNT_PARSED(values) count_parsed(m_stats.stats, (values))
+#define PYSON_REPORT_STATS() StatsReport pyson_stats_report(m_stats)
+#else
+#define PYSON_COUNT(counter, amount) ((void)0)
+#define PYSON_COUNT_TYPE(type) ((void)0)
+#define PYSON_TIME(duration) ((void)0)
+#define PYSON_TIME_PARSE() ((void)0)
+#define PYSON_COUNT_PARSED(values) ((void)0)
+#define PYSON_REPORT_STATS() ((void)0)
+#endif
+
+#if POSIX_FUNCTIONS_AVAILABLE
+/**
+ * Reads a file descriptor ahead on a background thread, and splits what it read into lines.
+ * The thread reads buffers with pread() and queues them, the reader takes them off the queue
+ * and hands the buffers back once it's done with them, so only depth + 1 buffers ever exist.
+ */
+class FileReader::ReadAhead {
+    struct Buffer {
+        std::vector<char> data;
+        size_t size = 0;
+        /// errno of a failed read, the last buffer of the queue if it isn't 0
+        int error = 0;
+    };
+
+    int m_fd;
+    ReadAheadOptions m_options;
+
+    // shared with the thread
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::deque<Buffer> m_ready;
+    std::vector<std::vector<char>> m_spare;
+    bool m_stop = false;
+    std::thread m_thread;
+
+    // only used by the reader
+    Buffer m_current{};
+    size_t m_current_pos = 0;
+    /// The start of a line that continues into the next buffer
+    std::string m_carry;
+    bool m_carry_returned = false;
+    bool m_ended = false;
+    /// Byte offset of the next line
+    uint64_t m_position = 0;
+
+    void fill(uint64_t offset) {
+        while (true) {
+            std::vector<char> data;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_changed.wait(lock, [&] { return m_stop || m_ready.size() < m_options.depth; });
+                if (m_stop) return;
+                if (!m_spare.empty()) {
+                    data = std::move(m_spare.back());
+                    m_spare.pop_back();
+                }
+            }
+            data.resize(m_options.buffer_size);
+
+            ssize_t read;
+            do read = pread(m_fd, data.data(), data.size(), static_cast<off_t>(offset));
+            while (read == -1 && errno == EINTR);
+
+            Buffer buffer{std::move(data), read > 0 ? static_cast<size_t>(read) : 0, read == -1 ? errno : 0};
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_ready.push_back(std::move(buffer));
+            }
+            m_changed.notify_all();
+            if (read <= 0) return; // an empty buffer marks the end of the file
+            offset += static_cast<uint64_t>(read);
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_changed.notify_all();
+        if (m_thread.joinable()) m_thread.join();
+        m_stop = false;
+        for (Buffer& buffer : m_ready) m_spare.push_back(std::move(buffer.data));
+        m_ready.clear();
+    }
+
+    // Wait for the next buffer, returns false at the end of the file
+    bool next_buffer() {
+        if (m_ended) return false;
+        if (!m_thread.joinable() && m_ready.empty()) m_thread = std::thread([this, offset = m_position + m_carry.size()] { fill(offset); });
+
+        Buffer next;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait(lock, [&] { return !m_ready.empty(); });
+            next = std::move(m_ready.front());
+            m_ready.pop_front();
+            if (!m_current.data.empty()) m_spare.push_back(std::move(m_current.data));
+        }
+        m_changed.notify_all();
+
+        m_current = std::move(next);
+        m_current_pos = 0;
+        if (m_current.error != 0) {
+            m_ended = true;
+            throw std::runtime_error(
+                "pread() IO error code "
+                + std::to_string(m_current.error)
+                + " in FileReader::read_line()"
+            );
+        }
+        if (m_current.size == 0) {
+            m_ended = true;
+            if (m_thread.joinable()) m_thread.join();
+            return false;
+        }
+        return true;
+    }
+
+public:
+    ReadAhead(int fd, ReadAheadOptions options, uint64_t position) : m_fd(fd), m_options(options), m_position(position) {
+        if (m_options.buffer_size == 0) m_options.buffer_size = 1;
+        if (m_options.depth == 0) m_options.depth = 1;
+    }
+    ~ReadAhead() { stop(); }
+
+    /// Where the next line starts
+    uint64_t position() const noexcept { return m_position; }
+
+    /// Throw away everything read so far and continue from offset (the thread starts again on the next read)
+    void seek(uint64_t offset) {
+        stop();
+        if (!m_current.data.empty()) m_spare.push_back(std::move(m_current.data));
+        m_current = Buffer{};
+        m_current_pos = 0;
+        m_carry.clear();
+        m_carry_returned = false;
+        m_ended = false;
+        m_position = offset;
+    }
+
+    /**
+     * Get the next line without its newline, and how many bytes it took up in the file,
+     * or return false at the end of the file. The line is only valid until the next call.
+     */
+    bool next_line(std::string_view& line, uint64_t& length) {
+        if (m_carry_returned) {
+            m_carry.clear();
+            m_carry_returned = false;
+        }
+        while (true) {
+            const char *data = m_current.data.data() + m_current_pos;
+            size_t available = m_current.size - m_current_pos;
+            const char *newline = available != 0 ? static_cast<const char *>(std::memchr(data, '\n', available)) : nullptr;
+            if (newline != nullptr) {
+                size_t used = static_cast<size_t>(newline - data);
+                m_current_pos += used + 1;
+                if (m_carry.empty()) {
+                    line = std::string_view(data, used);
+                } else {
+                    m_carry.append(data, used);
+                    line = m_carry;
+                    m_carry_returned = true;
+                }
+                length = line.size() + 1;
+                m_position += length;
+                return true;
+            }
+            m_carry.append(data, available);
+            m_current_pos = m_current.size;
+
+            if (!next_buffer()) {
+                // the last line doesn't have a newline
+                if (m_carry.empty()) return false;
+                line = m_carry;
+                m_carry_returned = true;
+                length = line.size();
+                m_position += length;
+                return true;
+            }
+        }
+    }
+};
+
+FileReader::ReadAheadHandle& FileReader::ReadAheadHandle::operator= (const ReadAheadHandle&) noexcept {
+    // the FILE this read ahead on is being replaced, so stop
+    delete ptr;
+    ptr = nullptr;
+    return *this;
+}
+FileReader::ReadAheadHandle& FileReader::ReadAheadHandle::operator= (ReadAheadHandle&& other) noexcept {
+    if (this == &other) return *this;
+    delete ptr;
+    ptr = other.ptr;
+    other.ptr = nullptr;
+    return *this;
+}
+FileReader::ReadAheadHandle::~ReadAheadHandle() noexcept { delete ptr; }
+
+namespace {
+
+// Move a FILE to a byte offset, the read ahead thread uses pread() and leaves it where it was
+void seek_file(FILE *handle, uint64_t position, const char *caller) {
+    clearerr(handle);
+    if (fseeko(handle, static_cast<off_t>(position), SEEK_SET) != 0) {
+        throw std::runtime_error(
+            "fseeko() IO error code "
+            + std::to_string(errno)
+            + " in "
+            + caller
+        );
+    }
+}
+
+}
+
+FileReader::FileReader(const FileReader& other)
+    : m_handle(other.m_handle), m_line(other.m_line), m_read_ahead(other.m_read_ahead),
+      m_spare(other.m_spare), m_name_index(other.m_name_index), m_offsets(other.m_offsets)
+#if PYSON_STATS
+      , m_stats(other.m_stats)
+#endif
+{
+    if (other.m_read_ahead.ptr != nullptr)
+        seek_file(m_handle, other.m_read_ahead.ptr->position(), "FileReader::FileReader(const FileReader&)");
+}
+
+FileReader& FileReader::operator= (const FileReader& other) {
+    if (this == &other) return *this;
+    if (other.m_read_ahead.ptr != nullptr)
+        seek_file(other.m_handle, other.m_read_ahead.ptr->position(), "FileReader::operator=()");
+    m_handle = other.m_handle;
+    m_line = other.m_line;
+    m_read_ahead = other.m_read_ahead;
+    m_spare = other.m_spare;
+    m_name_index = other.m_name_index;
+    m_offsets = other.m_offsets;
+#if PYSON_STATS
+    m_stats = other.m_stats;
+#endif
+    return *this;
+}
+
+FileReader::FileReader(const char *path) : m_handle(fopen(path, "r")) {
+    if (m_handle == nullptr) {
+        throw std::runtime_error(
+            "fopen() IO error code "
+            + std::to_string(errno)
+            + " in FileReader::FileReader(const char *path)"
+        );
+    }
+}
+FileReader::FileReader(const std::string& path) : m_handle(fopen(path.c_str(), "r")) {
+    if (m_handle == nullptr) {
+        throw std::runtime_error(
+            "fopen() IO error code "
+            + std::to_string(errno)
+            + " in FileReader::FileReader(const std::string& path)"
+        );
+    }
+}
+
+bool FileReader::read_line(std::string_view& line, uint64_t& start, uint64_t& end) {
+    start = m_offsets.has_value() ? m_offsets->offset : 0;
+    if (m_read_ahead.ptr != nullptr) {
+        uint64_t length;
+        bool read;
+        {
+            PYSON_TIME(io_time);
+            read = m_read_ahead.ptr->next_line(line, length);
+        }
+        if (!read) {
+            track_end();
+            return false;
+        }
+        PYSON_COUNT(bytes_read, length);
+        end = start + length;
+        return true;
+    }
+
+    ssize_t len;
+    {
+        PYSON_TIME(io_time);
+        len = getline(&m_line.data, &m_line.capacity, m_handle);
+    }
+    if (len == -1) {
+        track_end();
+        return false;
+    }
+    PYSON_COUNT(bytes_read, static_cast<uint64_t>(len));
+    end = start + static_cast<uint64_t>(len);
+
+    // getline() keeps the newline
+    size_t length = static_cast<size_t>(len);
+    if (length != 0 && m_line.data[length - 1] == '\n') length--;
+    line = std::string_view(m_line.data, length);
+    return true;
+}
+
+void FileReader::go_to_offset(uint64_t offset, uint64_t line) {
+    clearerr(m_handle);
+    if (fseeko(m_handle, static_cast<off_t>(offset), SEEK_SET) != 0) {
+        throw std::runtime_error(
+            "fseeko() IO error code "
+            + std::to_string(errno)
+            + " in FileReader::go_to_offset()"
+        );
+    }
+    if (m_read_ahead.ptr != nullptr) m_read_ahead.ptr->seek(offset);
+    if (offset == 0) PYSON_COUNT(rewinds, 1);
+    else PYSON_COUNT(seeks, 1);
+    if (m_offsets.has_value()) {
+        m_offsets->position_known = true;
+        m_offsets->line = line;
+        m_offsets->offset = offset;
+    }
+}
+uint64_t FileReader::current_offset() {
+    if (m_read_ahead.ptr != nullptr) return m_read_ahead.ptr->position();
+    off_t offset = ftello(m_handle);
+    if (offset == -1) {
+        throw std::runtime_error(
+            "ftello() IO error code "
+            + std::to_string(errno)
+            + " in FileReader::current_offset()"
+        );
+    }
+    return static_cast<uint64_t>(offset);
+}
+void FileReader::skip_lines(size_t amount, const char *eof_message) {
+    for (size_t i = 0; i < amount; i++) {
+        std::string_view line;
+        uint64_t start, end;
+        if (!read_line(line, start, end)) throw std::runtime_error(eof_message);
+        PYSON_COUNT(lines_skipped, 1);
+        track_line(start, end, std::nullopt);
+    }
+}
+
+std::pmr::string FileReader::read_whole_file(std::pmr::memory_resource *resource) {
+    go_to_beginning();
+    PYSON_TIME(io_time);
+    struct stat info;
+    size_t expected = fstat(fileno(m_handle), &info) == 0 ? static_cast<size_t>(info.st_size) : 0;
+
+    // read straight into the string, then keep going in case the file grew
+    std::pmr::string contents(expected, '\0', resource);
+    contents.resize(fread(contents.data(), 1, expected, m_handle));
+    char buffer[4096];
+    while (size_t read = fread(buffer, 1, sizeof(buffer), m_handle))
+        contents.append(buffer, read);
+
+    if (ferror(m_handle))
+        throw std::runtime_error("fread() IO error in FileReader::read_whole_file()");
+    PYSON_COUNT(bytes_read, contents.size());
+    // the FILE is at the end now, so reading ahead should be too
+    if (m_read_ahead.ptr != nullptr) m_read_ahead.ptr->seek(contents.size());
+    if (m_offsets.has_value()) m_offsets->position_known = false;
+    return contents;
+}
+
+void FileReader::read_ahead(ReadAheadOptions options) {
+    uint64_t position = current_offset();
+    delete m_read_ahead.ptr;
+    m_read_ahead.ptr = nullptr;
+    m_read_ahead.ptr = new ReadAhead(fileno(m_handle), options, position);
+}
+void FileReader::stop_read_ahead() {
+    if (m_read_ahead.ptr == nullptr) return;
+    uint64_t position = m_read_ahead.ptr->position();
+    delete m_read_ahead.ptr;
+    m_read_ahead.ptr = nullptr;
+    seek_file(m_handle, position, "FileReader::stop_read_ahead()");
+}
+
+#else // windows
+FileReader::FileReader(const char *path) : m_stream() {
+    m_stream.open(path);
+    if (!m_stream.good()) {
+        throw std::runtime_error(
+            "Error opening file in FileReader::FileReader(const char *path)"
+        );
+    }
+}
+FileReader::FileReader(const std::string& path) : m_stream() {
+    m_stream.open(path.c_str());
+    if (!m_stream.good()) {
+        throw std::runtime_error(
+            "Error opening file in FileReader::FileReader(const std::string& path)"
+        );
+    }
+}
+
+bool FileReader::read_line(std::string_view& line, uint64_t& start, uint64_t& end) {
+    start = m_offsets.has_value() ? current_offset() : 0;
+    bool read;
+    {
+        PYSON_TIME(io_time);
+        read = static_cast<bool>(std::getline(m_stream, m_line));
+    }
+    if (!read) {
+        track_end();
+        return false;
+    }
+    // getline() only sets eofbit if the line had no newline
+    PYSON_COUNT(bytes_read, m_line.size() + (m_stream.eof() ? 0 : 1));
+    end = m_offsets.has_value() ? current_offset() : 0;
+    line = m_line;
+    return true;
+}
+
+void FileReader::go_to_offset(uint64_t offset, uint64_t line) {
+    m_stream.clear();
+    if (!m_stream.seekg(static_cast<std::streamoff>(offset)))
+        throw std::runtime_error("Error seeking in FileReader::go_to_offset()");
+    if (offset == 0) PYSON_COUNT(rewinds, 1);
+    else PYSON_COUNT(seeks, 1);
+    if (m_offsets.has_value()) {
+        m_offsets->position_known = true;
+        m_offsets->line = line;
+        m_offsets->offset = offset;
+    }
+}
+uint64_t FileReader::current_offset() {
+    // tellg() refuses to answer once eofbit is set, even though the position is still known
+    std::ios::iostate state = m_stream.rdstate();
+    m_stream.clear();
+    std::streamoff offset = m_stream.tellg();
+    m_stream.clear(state);
+    if (offset < 0)
+        throw std::runtime_error("Error getting position in FileReader::current_offset()");
+    return static_cast<uint64_t>(offset);
+}
+void FileReader::skip_lines(size_t amount, const char *eof_message) {
+    for (size_t i = 0; i < amount; i++) {
+        if (m_stream.eof()) {
+            track_end();
+            throw std::runtime_error(eof_message);
+        }
+        uint64_t start = m_offsets.has_value() ? current_offset() : 0;
+        {
+            PYSON_TIME(io_time);
+            m_stream.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+        if (m_stream.gcount() != 0) {
+            PYSON_COUNT(bytes_read, static_cast<uint64_t>(m_stream.gcount()));
+            PYSON_COUNT(lines_skipped, 1);
+            track_line(start, m_offsets.has_value() ? current_offset() : 0, std::nullopt);
+        }
+    }
+}
+
+void FileReader::read_ahead(ReadAheadOptions) {}
+void FileReader::stop_read_ahead() {}
+
+std::pmr::string FileReader::read_whole_file(std::pmr::memory_resource *resource) {
+    go_to_beginning();
+    PYSON_TIME(io_time);
+    std::pmr::string contents(std::istreambuf_iterator<char>(m_stream), std::istreambuf_iterator<char>{}, resource);
+    if (m_stream.bad())
+        throw std::runtime_error("IO error in FileReader::read_whole_file()");
+    PYSON_COUNT(bytes_read, contents.size());
+    if (m_offsets.has_value()) m_offsets->position_known = false;
+    return contents;
+}
+#endif // functions that work for both
+template <class Record>
+bool FileReader::read_next(Record& out, const char *invalid_message) {
+    std::string_view line;
+    uint64_t start, end;
+    if (!read_line(line, start, end)) return false;
+
+    bool valid;
+    {
+        PYSON_TIME(parse_time);
+        valid = parse_record(line.data(), line.size(), out, m_spare);
+    }
+    track_line(start, end, valid ? std::optional<std::string_view>(out.m_name) : std::nullopt);
+    if (!valid) {
+        PYSON_COUNT(parse_failures, 1);
+        throw std::runtime_error(invalid_message);
+    }
+    PYSON_COUNT(lines_parsed, 1);
+    PYSON_COUNT_TYPE(out.m_value.m_type);
+    return true;
+}
+
+std::optional<NamedValue> FileReader::next() {
+    NamedValue result("", Value(0));
+    if (read_next(result, "Invalid pyson value encountered in FileReader::next()")) return result;
+    else return std::nullopt;
+}
+NamedValue FileReader::next_or(const NamedValue& default_val) {
+    NamedValue result("", Value(0));
+    if (read_next(result, "Invalid pyson value encountered in FileReader::next_or()")) return result;
+    else return default_val;
+}
+NamedValue FileReader::next_or(NamedValue&& default_val) {
+    NamedValue result("", Value(0));
+    if (read_next(result, "Invalid pyson value encountered in FileReader::next_or()")) return result;
+    else return std::move(default_val);
+}
+bool FileReader::next_into(NamedValue& out) {
+    return read_next(out, "Invalid pyson value encountered in FileReader::next_into()");
+}
+NamedValue FileReader::next_or_throw() {
+    NamedValue result("", Value(0));
+    if (read_next(result, "Invalid pyson value encountered in FileReader::next_or_throw()")) return result;
+    else throw std::runtime_error("EOF encountered in FileReader::next_or_throw()");
+}
+std::optional<LazyNamedValue> FileReader::next_lazy() {
+    LazyNamedValue result("", LazyValue(Value(0)));
+    if (read_next(result, "Invalid pyson line encountered in FileReader::next_lazy()")) return result;
+    else return std::nullopt;
+}
+bool FileReader::next_lazy_into(LazyNamedValue& out) {
+    return read_next(out, "Invalid pyson line encountered in FileReader::next_lazy_into()");
+}
+
+void FileReader::go_to_beginning() { go_to_offset(0, 0); }
+void FileReader::go_to_line(size_t line_number) {
+    PYSON_REPORT_STATS();
+    const char *eof_message = "File ended before requested line in FileReader::go_to_line()";
+    if (m_offsets.has_value() && !m_offsets->checkpoints.empty()) {
+        OffsetTable& table = m_offsets.value();
+        size_t interval = table.options.checkpoint_interval;
+        size_t checkpoint = std::min(line_number / interval, table.checkpoints.size() - 1);
+        uint64_t checkpoint_line = static_cast<uint64_t>(checkpoint) * interval;
+
+        // if the reader is already between the checkpoint and the line, just keep going
+        if (!(table.position_known && table.line >= checkpoint_line && table.line <= line_number))
+            go_to_offset(table.checkpoints[checkpoint], checkpoint_line);
+        skip_lines(line_number - table.line, eof_message);
+        return;
+    }
+    go_to_beginning();
+    skip_lines(line_number, eof_message);
+}
+void FileReader::skip_n_lines(size_t amount_to_skip) {
+    skip_lines(amount_to_skip, "File ended before requested line in FileReader::skip_n_lines()");
+}
+
+void FileReader::remember_offsets(OffsetTableOptions options) {
+    if (options.checkpoint_interval == 0) options.checkpoint_interval = 1;
+    uint64_t offset = current_offset();
+    m_offsets = OffsetTable{options, {}, {}, 0, 0, false, offset == 0, 0, offset};
+}
+
+void FileReader::track_line(uint64_t start, uint64_t end, std::optional<std::string_view> name) {
+    if (!m_offsets.has_value() || !m_offsets->position_known) return;
+    OffsetTable& table = m_offsets.value();
+
+    size_t interval = table.options.checkpoint_interval;
+    if (table.line % interval == 0 && table.line / interval == table.checkpoints.size())
+        table.checkpoints.push_back(start);
+
+    // names are only recorded in order from the top, so the first line with each name wins
+    if (table.options.names && name.has_value() && table.line == table.names_through) {
+        table.names.try_emplace(std::string(*name), NameIndex::Location{start, table.line});
+        table.names_through++;
+        table.names_resume_offset = end;
+    }
+
+    table.line++;
+    table.offset = end;
+}
+
+#if PYSON_STATS
+ReaderStats FileReader::stats() const noexcept { return m_stats.stats; }
+void FileReader::reset_stats() noexcept { m_stats.stats = ReaderStats{}; }
+void FileReader::set_stats_sink(StatsSink sink) { m_stats.sink = std::move(sink); }
+#else
+ReaderStats FileReader::stats() const noexcept { return ReaderStats{}; }
+void FileReader::reset_stats() noexcept {}
+void FileReader::set_stats_sink(StatsSink) {}
+#endif
+
+void FileReader::track_end() noexcept {
+    if (!m_offsets.has_value() || !m_offsets->position_known) return;
+    if (m_offsets->line == m_offsets->names_through) m_offsets->names_complete = true;
+}
+std::vector<NamedValue> FileReader::all() {
+    PYSON_REPORT_STATS();
+    std::pmr::string contents = read_whole_file();
+    PYSON_TIME_PARSE();
+    std::vector<NamedValue> values{};
+    parse_buffer(contents, values, "Invalid pyson value encountered in FileReader::all()");
+    PYSON_COUNT_PARSED(values);
+    return values;
+}
+std::vector<NamedValue> FileReader::all(ParallelOptions options) {
+    PYSON_REPORT_STATS();
+    std::pmr::string contents = read_whole_file();
+    PYSON_TIME_PARSE();
+    std::vector<std::string_view> chunks = split_into_chunks(contents, options);
+    std::vector<std::vector<NamedValue>> parts(chunks.size());
+    run_on_threads(chunks.size(), [&](size_t i) {
+        parse_buffer(chunks[i], parts[i], "Invalid pyson value encountered in FileReader::all()");
+    });
+
+    // stitch the chunks back together in file order
+    std::vector<NamedValue> values{};
+    size_t total = 0;
+    for (const std::vector<NamedValue>& part : parts) total += part.size();
+    values.reserve(total);
+    for (std::vector<NamedValue>& part : parts)
+        std::move(part.begin(), part.end(), std::back_inserter(values));
+    PYSON_COUNT_PARSED(values);
+    return values;
+}
+
+std::unordered_map<std::string, Value> FileReader::as_hashmap() {
+    PYSON_REPORT_STATS();
+    std::pmr::string contents = read_whole_file();
+    PYSON_TIME_PARSE();
+    std::unordered_map<std::string, Value> map;
+    parse_buffer(
+        contents,
+        map,
+        "Invalid pyson value encountered in FileReader::as_hashmap()",
+        "Duplicate name encountered in FileReader::as_hashmap()"
+    );
+    PYSON_COUNT_PARSED(map);
+    return map;
+}
+std::unordered_map<std::string, Value> FileReader::as_hashmap(ParallelOptions options) {
+    PYSON_REPORT_STATS();
+    std::pmr::string contents = read_whole_file();
+    PYSON_TIME_PARSE();
+    std::vector<std::string_view> chunks = split_into_chunks(contents, options);
+    std::vector<std::unordered_map<std::string, Value>> parts(chunks.size());
+    run_on_threads(chunks.size(), [&](size_t i) {
+        parse_buffer(
+            chunks[i],
+            parts[i],
+            "Invalid pyson value encountered in FileReader::as_hashmap()",
+            "Duplicate name encountered in FileReader::as_hashmap()"
+        );
+    });
+
+    // anything merge() leaves behind was already in the map from an earlier chunk
+    if (parts.empty()) return {};
+    std::unordered_map<std::string, Value> map = std::move(parts[0]);
+    for (size_t i = 1; i < parts.size(); i++) {
+        map.merge(parts[i]);
+        if (!parts[i].empty())
+            throw std::runtime_error("Duplicate name encountered in FileReader::as_hashmap()");
+    }
+    PYSON_COUNT_PARSED(map);
+    return map;
+}
+
+std::vector<LazyNamedValue> FileReader::all_lazy() {
+    PYSON_REPORT_STATS();
+    std::pmr::string contents = read_whole_file();
+    PYSON_TIME_PARSE();
+    StructuralIndex index = StructuralIndex::build(contents.data(), contents.size());
+    std::vector<LazyNamedValue> values{};
+    values.reserve(index.line_count());
+    for (size_t i = 0; i < index.line_count(); i++) {
+        std::string_view line(contents.data() + index.line_starts[i], index.line_ends[i] - index.line_starts[i]);
+        values.emplace_back("", LazyValue(PysonType::PysonInt, std::string{}));
+        if (!LazyNamedValue::from_line(line, values.back()))
+            throw std::runtime_error("Invalid pyson line encountered in FileReader::all_lazy()");
+        PYSON_COUNT(lines_parsed, 1);
+        PYSON_COUNT_TYPE(values.back().m_value.m_type);
+    }
+    return values;
+}
+
+Document FileReader::load_document(std::pmr::memory_resource *resource) {
+    PYSON_REPORT_STATS();
+    Document document(resource);
+    document.m_storage->text = read_whole_file(document.m_storage->resource);
+    PYSON_TIME_PARSE();
+    document.parse_text("Invalid pyson value encountered in FileReader::load_document()");
+    PYSON_COUNT_PARSED(document);
+    return document;
+}
+
+ColumnarTable FileReader::load_columnar() {
+    return ColumnarTable(load_document());
+}
+
+FrozenMap FileReader::as_frozen_map() {
+    return FrozenMap(all());
+}
+
+FrozenMap FileReader::as_frozen_map(ParallelOptions options) {
+    return FrozenMap(all(options));
+}
+
+std::optional<Value> FileReader::value_with_name(const char *name) {
+    PYSON_REPORT_STATS();
+    if (m_name_index.has_value()) {
+        std::optional<Value> found = std::nullopt;
+        m_name_index->for_each_candidate(name, [&](NameIndex::Location location) {
+            go_to_offset(location.offset, location.line);
+            std::optional<NamedValue> current = next();
+            if (!current.has_value() || current->name_ref() != name) return false;
+            found = std::move(*current).value();
+            return true;
+        });
+        return found;
+    }
+
+    if (m_offsets.has_value() && m_offsets->options.names) {
+        OffsetTable& table = m_offsets.value();
+        auto known = table.names.find(name);
+        if (known != table.names.end()) {
+            go_to_offset(known->second.offset, known->second.line);
+            std::optional<NamedValue> current = next();
+            if (current.has_value() && current->name_ref() == name)
+                return std::move(*current).value();
+            // the file changed under us, forget what we knew and read everything again
+            remember_offsets(table.options);
+        } else if (table.names_complete) {
+            return std::nullopt;
+        } else {
+            // every name before names_through is already known, so start reading after them
+            go_to_offset(table.names_resume_offset, table.names_through);
+            for (std::optional<NamedValue> current = next(); current.has_value(); current = next()) {
+                if (current->name_ref() == name)
+                    return std::move(*current).value();
+            }
+            return std::nullopt;
+        }
+    }
+
+    go_to_beginning();
+    for (std::optional<NamedValue> current = next(); current.has_value(); current = next()) {
+        if (current->name_ref() == name)
+            return std::move(*current).value();
+    }
+    return std::nullopt;
+}
+
+bool FileReader::scan_next(const ScanFilter& filter, NamedValue& out, const char *invalid_message) {
+    std::string_view line;
+    uint64_t start, end;
+    while (read_line(line, start, end)) {
+        bool valid, accepted;
+        {
+            PYSON_TIME(parse_time);
+            LineSplit split;
+            PysonType type;
+            valid = split_line(line.data(), line.size(), split)
+                && parse_type_tag(line.data() + split.first_colon + 1, split.second_colon - split.first_colon - 1, type);
+            accepted = valid && filter.accepts(line.substr(0, split.first_colon), type);
+            if (accepted)
+                valid = parse_line(line.data(), line.size(), split.first_colon, split.second_colon, out, m_spare);
+            if (valid)
+                track_line(start, end, line.substr(0, split.first_colon));
+        }
+        if (!valid) {
+            track_line(start, end, std::nullopt);
+            PYSON_COUNT(parse_failures, 1);
+            throw std::runtime_error(invalid_message);
+        }
+        if (!accepted) {
+            PYSON_COUNT(lines_filtered, 1);
+            continue;
+        }
+        PYSON_COUNT(lines_parsed, 1);
+        PYSON_COUNT_TYPE(out.m_value.m_type);
+        return true;
+    }
+    return false;
+}
+
+bool FileReader::next_into(const ScanFilter& filter, NamedValue& out) {
+    return scan_next(filter, out, "Invalid pyson value encountered in FileReader::next_into()");
+}
+
+std::vector<NamedValue> FileReader::scan(const ScanFilter& filter) {
+    std::vector<NamedValue> values{};
+    NamedValue next("", Value(0));
+    while (scan_next(filter, next, "Invalid pyson value encountered in FileReader::scan()"))
+        values.push_back(std::move(next));
+    return values;
+}
+
+void FileReader::scan(const ScanFilter& filter, const std::function<void (NamedValue&)>& callback) {
+    NamedValue next("", Value(0));
+    while (scan_next(filter, next, "Invalid pyson value encountered in FileReader::scan()"))
+        callback(next);
+}
+
+void FileReader::scan_while(const ScanFilter& filter, const std::function<bool (NamedValue&)>& callback) {
+    NamedValue next("", Value(0));
+    while (scan_next(filter, next, "Invalid pyson value encountered in FileReader::scan_while()")
+        && callback(next))
+        ; // no loop body
+}
+
+void FileReader::for_each(std::function<void (NamedValue)> predicate) {
+    for (auto v = next(); v != std::nullopt; v = next())
+        predicate(std::move(v.value()));
+}
+
+template <class Return>
+std::vector<Return> FileReader::map_each(std::function<Return (NamedValue)> predicate) {
+    auto vec = std::vector<Return>{};
+    for (auto v = next(); v != std::nullopt; v = next())
+        vec.push_back(predicate(v));
+    return vec;
+}
+
+void FileReader::for_each_while(std::function<bool (NamedValue)> predicate) {
+    for (auto v = next(); v != std::nullopt && predicate(v.value()); v = next())
+        ; // no loop body
+}
+
+template <class Return>
+std::vector<Return> FileReader::map_while(std::function<std::pair<bool, Return> (NamedValue)> predicate) {
+    auto vec = std::vector<Return>{};
+    for (auto val = next(); val != std::nullopt; val = next()) {
+        auto res = predicate(val);
+        if (!res.first) return vec;
+        else vec.push_back(res.second);
+    }
+    return vec;
+}
+
+template <class Return>
+std::vector<Return> FileReader::map_while(std::function<std::optional<Return> (NamedValue)> predicate) {
+    auto vec = std::vector<Return>{};
+    for (auto val = next(); val != std::nullopt; val = next()) {
+        auto res = predicate(val);
+        if (!res.has_value()) return vec;
+        else vec.push_back(res.value());
+    }
+    return vec;
+}
+
+FileReader::Iter::Iter(FileReader *reader) : m_reader(reader), m_cached("", Value(0)) {
+    if (m_reader != nullptr && !m_reader->next_into(m_cached))
+        m_reader = nullptr;
+}
+
+FileReader::End FileReader::end() { return End{}; }
 FileReader::Iter FileReader::begin() {
 #if POSIX_FUNCTIONS_AVAILABLE
-    int c;
-    if ((c = fgetc(m_handle)) == EOF)
-        return Iter(nullptr);
-    ungetc(c, m_handle);
-    return Iter(this);
+    if (m_read_ahead.ptr == nullptr) {
+        int c;
+        if ((c = fgetc(m_handle)) == EOF)
+            return Iter(nullptr);
+        ungetc(c, m_handle);
+    }
+    return Iter(this);
+#else
+    if (m_stream.peek() == EOF)
+        return Iter(nullptr);
+    else return Iter(this);
+#endif
+}
+
+FileReader::Iter& FileReader::Iter::operator++() {
+    if (m_reader != nullptr && !m_reader->next_into(m_cached))
+        m_reader = nullptr;
+    return *this;
+}
+
+const NamedValue& FileReader::Iter::operator*() const {
+    if (m_reader == nullptr)
+        throw std::logic_error("Tried to dereference finished FileReader::Iter iterator");
+    
+    return m_cached;
+}
+
+Generator<NamedValue> records(FileReader& reader) {
+    NamedValue record("", Value(0));
+    while (reader.next_into(record)) co_yield record;
+}
+
+Generator<NamedValue> records(FileReader& reader, ScanFilter filter) {
+    NamedValue record("", Value(0));
+    while (reader.next_into(filter, record)) co_yield record;
+}
+
+Generator<LazyNamedValue> lazy_records(FileReader& reader) {
+    LazyNamedValue record("", LazyValue(Value(0)));
+    while (reader.next_lazy_into(record)) co_yield record;
+}
+
+Generator<NamedValue> records(ReadMore read_more, size_t buffer_size) {
+    std::vector<char> buffer(std::max<size_t>(buffer_size, 1));
+    size_t begin = 0, filled = 0;
+    bool ended = false;
+    NamedValue record("", Value(0));
+    SpareStorage spare;
+
+    while (true) {
+        const char *data = buffer.data();
+        const char *newline = static_cast<const char *>(std::memchr(data + begin, '\n', filled - begin));
+        if (newline != nullptr || (ended && begin < filled)) {
+            size_t end = newline != nullptr ? static_cast<size_t>(newline - data) : filled;
+            if (!parse_unsplit_line(data + begin, end - begin, record, spare))
+                throw std::runtime_error("Invalid pyson value encountered in records()");
+            begin = newline != nullptr ? end + 1 : end;
+            co_yield record;
+            continue;
+        }
+        if (ended) co_return;
+
+        // keep the partial line, and make room for more of it if it fills the whole buffer
+        std::memmove(buffer.data(), data + begin, filled - begin);
+        filled -= begin;
+        begin = 0;
+        if (filled == buffer.size()) buffer.resize(buffer.size() * 2);
+        size_t read = read_more(std::span<char>(buffer.data() + filled, buffer.size() - filled));
+        if (read == 0) ended = true;
+        else filled += std::min(read, buffer.size() - filled);
+    }
+}
+
+// Split a line into name, type and payload without converting anything
+bool NamedValueView::from_line(std::string_view line, NamedValueView& out) noexcept {
+    LineSplit split;
+    if (!split_line(line.data(), line.size(), split)) return false;
+
+    std::string_view tag = line.substr(split.first_colon + 1, split.second_colon - split.first_colon - 1);
+    if (!parse_type_tag(tag.data(), tag.size(), out.m_type)) return false;
+
+    out.m_name = line.substr(0, split.first_colon);
+    out.m_type_tag = tag;
+    out.m_payload = line.substr(split.second_colon + 1);
+    return true;
+}
+
+Value NamedValueView::to_value() const {
+    switch (m_type) {
+        case PysonType::PysonInt: {
+            int val;
+            if (parse_int(m_payload.data(), m_payload.size(), val)) return Value(val);
+            throw std::runtime_error("Invalid pyson value encountered in NamedValueView::to_value()");
+        }
+        case PysonType::PysonFloat: {
+            double val;
+            if (parse_float(m_payload.data(), m_payload.size(), val)) return Value(val);
+            throw std::runtime_error("Invalid pyson value encountered in NamedValueView::to_value()");
+        }
+        case PysonType::PysonStr: return Value(std::string(m_payload));
+        case PysonType::PysonList: return Value::from_pyson_list(m_payload);
+    }
+    throw std::logic_error("Unknown PysonType in NamedValueView::to_value()");
+}
+
+bool NamedValueView::decode_into(int& out) const noexcept {
+    return m_type == PysonType::PysonInt && parse_int(m_payload.data(), m_payload.size(), out);
+}
+
+bool NamedValueView::decode_into(double& out) const noexcept {
+    return m_type == PysonType::PysonFloat && parse_float(m_payload.data(), m_payload.size(), out);
+}
+
+bool NamedValueView::decode_into(std::string& out) const {
+    if (m_type != PysonType::PysonStr) return false;
+    out.assign(m_payload);
+    return true;
+}
+
+bool NamedValueView::decode_into(std::vector<std::string>& out) const {
+    if (m_type != PysonType::PysonList) return false;
+    split_pyson_list(m_payload, out);
+    return true;
+}
+
+const Value& LazyValue::decode() const {
+    if (m_decoded.has_value()) return *m_decoded;
+    const char *payload = m_payload.data();
+    switch (m_type) {
+        case PysonType::PysonInt: {
+            int val;
+            if (!parse_int(payload, m_payload.size(), val))
+                throw std::runtime_error("Invalid pyson value encountered in LazyValue::decode()");
+            return m_decoded.emplace(val);
+        }
+        case PysonType::PysonFloat: {
+            double val;
+            if (!parse_float(payload, m_payload.size(), val))
+                throw std::runtime_error("Invalid pyson value encountered in LazyValue::decode()");
+            return m_decoded.emplace(val);
+        }
+        case PysonType::PysonStr: return m_decoded.emplace(m_payload);
+        case PysonType::PysonList: {
+            std::vector<std::string> list;
+            split_pyson_list(m_payload, list);
+            return m_decoded.emplace(std::move(list));
+        }
+    }
+    throw std::logic_error("Unknown PysonType in LazyValue::decode()");
+}
+
+bool LazyNamedValue::from_line(std::string_view line, LazyNamedValue& out) {
+    LineSplit split;
+    if (!split_line(line.data(), line.size(), split) || split.second_colon >= line.size()) return false;
+    PysonType type;
+    if (!parse_type_tag(line.data() + split.first_colon + 1, split.second_colon - split.first_colon - 1, type))
+        return false;
+
+    out.m_name.assign(line.data(), split.first_colon);
+    out.m_value.m_type = type;
+    out.m_value.m_payload.assign(line.substr(split.second_colon + 1));
+    out.m_value.m_decoded.reset();
+    return true;
+}
+
+NamedValue NamedValueView::to_named_value() const {
+    return NamedValue(std::string(m_name), to_value());
+}
+
+#if POSIX_FUNCTIONS_AVAILABLE
+FileMapping::FileMapping(const char *path, MapOptions options) : m_data(nullptr), m_size(0) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error(
+            "open() IO error code "
+            + std::to_string(errno)
+            + " in FileMapping::FileMapping()"
+        );
+    }
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        int error = errno;
+        close(fd);
+        throw std::runtime_error(
+            "fstat() IO error code "
+            + std::to_string(error)
+            + " in FileMapping::FileMapping()"
+        );
+    }
+    m_size = static_cast<size_t>(info.st_size);
+    // mmap() refuses to map nothing, an empty file is just an empty view
+    if (m_size == 0) {
+        close(fd);
+        return;
+    }
+
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if (options.populate) flags |= MAP_POPULATE;
+#endif
+    void *mapping = mmap(nullptr, m_size, PROT_READ, flags, fd, 0);
+    int error = errno;
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error(
+            "mmap() IO error code "
+            + std::to_string(error)
+            + " in FileMapping::FileMapping()"
+        );
+    }
+#ifdef MADV_SEQUENTIAL
+    if (options.sequential) madvise(mapping, m_size, MADV_SEQUENTIAL);
+#endif
+    m_data = static_cast<const char *>(mapping);
+}
+FileMapping::~FileMapping() noexcept {
+    if (m_data != nullptr)
+        munmap(const_cast<char *>(m_data), m_size);
+}
+FileMapping::FileMapping(FileMapping&& other) noexcept : m_data(other.m_data), m_size(other.m_size) {
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+FileMapping& FileMapping::operator= (FileMapping&& other) noexcept {
+    if (this == &other) return *this;
+    this->~FileMapping();
+    m_data = other.m_data;
+    m_size = other.m_size;
+    other.m_data = nullptr;
+    other.m_size = 0;
+    return *this;
+}
+#else // windows
+FileMapping::FileMapping(const char *path, MapOptions options) : m_data(nullptr), m_size(0), m_buffer() {
+    (void)options;
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream.good())
+        throw std::runtime_error("Error opening file in FileMapping::FileMapping()");
+    m_buffer.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+}
+FileMapping::~FileMapping() noexcept {}
+FileMapping::FileMapping(FileMapping&& other) noexcept : m_data(nullptr), m_size(other.m_size), m_buffer(std::move(other.m_buffer)) {
+    m_data = m_buffer.data();
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+FileMapping& FileMapping::operator= (FileMapping&& other) noexcept {
+    m_buffer = std::move(other.m_buffer);
+    m_data = m_buffer.data();
+    m_size = other.m_size;
+    other.m_data = nullptr;
+    other.m_size = 0;
+    return *this;
+}
+#endif
+
+namespace {
+
+// Sidecar layout: header, then slot_count slots of (hash, offset, line), all native-endian uint64_t
+constexpr char name_index_magic[8] = {'P', 'Y', 'S', 'O', 'N', 'I', 'X', '1'};
+struct NameIndexHeader {
+    char magic[8];
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t name_count;
+    uint64_t slot_count;
+};
+
+// 64-bit FNV-1a, 0 is kept for empty slots
+uint64_t hash_name(std::string_view name) noexcept {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash == 0 ? 1 : hash;
+}
+
+// Size and modification time of the file the sidecar describes, false if it can't be read
+bool source_stamp(const char *path, uint64_t& size, int64_t& mtime) noexcept {
+    std::error_code error;
+    std::filesystem::path source(path);
+    size = std::filesystem::file_size(source, error);
+    if (error) return false;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(source, error);
+    if (error) return false;
+    mtime = static_cast<int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+}
+
+NameIndex NameIndex::build(const char *pyson_path) {
+    NameIndexHeader header;
+    std::memcpy(header.magic, name_index_magic, sizeof(header.magic));
+    if (!source_stamp(pyson_path, header.source_size, header.source_mtime))
+        throw std::runtime_error("Couldn't read file size or modification time in NameIndex::build()");
+
+    // find the start and name of every line, keeping the first line for each name
+    FileMapping mapping(pyson_path, MapOptions{});
+    std::string_view contents(mapping.data(), mapping.size());
+    std::vector<std::pair<std::string_view, Location>> lines;
+    std::unordered_set<std::string_view> seen;
+    uint64_t line = 0;
+    for (size_t start = 0; start < contents.size(); line++) {
+        size_t end = contents.find('\n', start);
+        if (end == std::string_view::npos) end = contents.size();
+        size_t colon = contents.find(':', start);
+        if (colon == std::string_view::npos || colon > end)
+            throw std::runtime_error("Invalid pyson value encountered in NameIndex::build()");
+        std::string_view name = contents.substr(start, colon - start);
+        if (seen.insert(name).second) lines.push_back({name, Location{start, line}});
+        start = end + 1;
+    }
+
+    NameIndex index;
+    size_t slot_count = 16;
+    while (slot_count < lines.size() * 2) slot_count *= 2;
+    index.m_slots.assign(slot_count, Slot{0, Location{0, 0}});
+    for (const std::pair<std::string_view, Location>& entry : lines) {
+        uint64_t hash = hash_name(entry.first);
+        size_t i = hash & (slot_count - 1);
+        while (index.m_slots[i].hash != 0) i = (i + 1) & (slot_count - 1);
+        index.m_slots[i] = Slot{hash, entry.second};
+    }
+    index.m_size = lines.size();
+
+    header.name_count = index.m_size;
+    header.slot_count = slot_count;
+    std::string path = sidecar_path(pyson_path);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(index.m_slots.data()), slot_count * sizeof(Slot));
+    if (!out.good())
+        throw std::runtime_error("Error writing " + path + " in NameIndex::build()");
+    return index;
+}
+
+std::optional<NameIndex> NameIndex::load(const char *pyson_path) {
+    uint64_t size;
+    int64_t mtime;
+    if (!source_stamp(pyson_path, size, mtime)) return std::nullopt;
+
+    std::string path = sidecar_path(pyson_path);
+    std::error_code error;
+    uint64_t sidecar_size = std::filesystem::file_size(path, error);
+    if (error || sidecar_size < sizeof(NameIndexHeader)) return std::nullopt;
+
+    std::ifstream in(path, std::ios::binary);
+    NameIndexHeader header;
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header))) return std::nullopt;
+    if (std::memcmp(header.magic, name_index_magic, sizeof(header.magic)) != 0) return std::nullopt;
+    if (header.source_size != size || header.source_mtime != mtime) return std::nullopt;
+    if (header.slot_count == 0 || (header.slot_count & (header.slot_count - 1)) != 0) return std::nullopt;
+    // the slots have to be in the file, before anything is allocated for them
+    if (header.slot_count > (sidecar_size - sizeof(NameIndexHeader)) / sizeof(Slot)) return std::nullopt;
+    if (header.name_count >= header.slot_count) return std::nullopt;
+
+    NameIndex index;
+    index.m_slots.resize(header.slot_count);
+    if (!in.read(reinterpret_cast<char *>(index.m_slots.data()), header.slot_count * sizeof(Slot)))
+        return std::nullopt;
+    // every name has a slot and at least one slot is empty, or for_each_candidate() would never stop
+    size_t filled = 0;
+    for (const Slot& slot : index.m_slots) filled += slot.hash != 0;
+    if (filled != header.name_count) return std::nullopt;
+    index.m_size = header.name_count;
+    return index;
+}
+
+NameIndex NameIndex::load_or_build(const char *pyson_path) {
+    std::optional<NameIndex> index = load(pyson_path);
+    if (index.has_value()) return std::move(index.value());
+    return build(pyson_path);
+}
+
+void NameIndex::for_each_candidate(std::string_view name, const std::function<bool(Location)>& predicate) const {
+    if (m_slots.empty()) return;
+    uint64_t hash = hash_name(name);
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = hash & mask; m_slots[i].hash != 0; i = (i + 1) & mask) {
+        if (m_slots[i].hash == hash && predicate(m_slots[i].location)) return;
+    }
+}
+
+MappedFileReader::MappedFileReader(const char *path, MapOptions options)
+    : m_mapping(path, options), m_position(0) {}
+
+std::optional<NamedValueView> MappedFileReader::next() {
+    if (m_position >= m_mapping.size()) return std::nullopt;
+
+    const char *start = m_mapping.data() + m_position;
+    size_t remaining = m_mapping.size() - m_position;
+    const char *newline = static_cast<const char *>(std::memchr(start, '\n', remaining));
+    size_t length = newline == nullptr ? remaining : static_cast<size_t>(newline - start);
+    m_position += newline == nullptr ? length : length + 1;
+
+    NamedValueView view;
+    if (NamedValueView::from_line(std::string_view(start, length), view)) return view;
+    else throw std::runtime_error("Invalid pyson value encountered in MappedFileReader::next()");
+}
+
+std::vector<NamedValue> MappedFileReader::all() {
+    std::vector<NamedValue> values{};
+    parse_buffer(contents(), values, "Invalid pyson value encountered in MappedFileReader::all()");
+    m_position = m_mapping.size();
+    return values;
+}
+
+MappedFileReader::Iter::Iter(MappedFileReader *reader) : m_reader(reader), m_cached() {
+    ++*this;
+}
+
+MappedFileReader::Iter& MappedFileReader::Iter::operator++() {
+    if (m_reader == nullptr)
+        return *this;
+    auto opt = m_reader->next();
+    if (!opt.has_value()) {
+        m_reader = nullptr;
+        return *this;
+    }
+    m_cached = opt.value();
+    return *this;
+}
+
+NamedValueView MappedFileReader::Iter::operator*() const {
+    if (m_reader == nullptr)
+        throw std::logic_error("Tried to dereference finished MappedFileReader::Iter iterator");
+    return m_cached;
+}
+
+#if POSIX_FUNCTIONS_AVAILABLE
+SharedFileReader::SharedFileReader(const char *path, SharedReaderOptions options)
+    : m_path(path), m_options(options), m_fd(-1), m_line_starts(), m_name_index() {
+    m_fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (m_fd == -1) {
+        throw std::runtime_error(
+            "open() IO error code "
+            + std::to_string(errno)
+            + " in SharedFileReader::SharedFileReader()"
+        );
+    }
+    try {
+        if (m_options.cursor_buffer_size == 0) m_options.cursor_buffer_size = 1;
+        if (m_options.index_lines) {
+            // the cursor finds the line boundaries without parsing anything
+            Cursor cursor(this, 0);
+            std::string_view line;
+            for (uint64_t start = 0; cursor.next_line(line); start = cursor.offset())
+                m_line_starts.push_back(start);
+        }
+        if (m_options.name_index) m_name_index = NameIndex::load_or_build(path);
+    } catch (...) {
+        close(m_fd);
+        throw;
+    }
+}
+
+SharedFileReader::~SharedFileReader() noexcept {
+    close(m_fd);
+}
+
+size_t SharedFileReader::read_bytes(uint64_t offset, char *out, size_t length) const {
+    for (;;) {
+        ssize_t count = pread(m_fd, out, length, static_cast<off_t>(offset));
+        if (count >= 0) return static_cast<size_t>(count);
+        if (errno != EINTR) {
+            throw std::runtime_error(
+                "pread() IO error code "
+                + std::to_string(errno)
+                + " in SharedFileReader::read_bytes()"
+            );
+        }
+    }
+}
+#else
+SharedFileReader::SharedFileReader(const char *path, SharedReaderOptions options)
+    : m_path(path), m_options(options), m_stream_mutex(), m_stream(path, std::ios::binary),
+      m_line_starts(), m_name_index() {
+    if (!m_stream.is_open())
+        throw std::runtime_error("Couldn't open " + m_path + " in SharedFileReader::SharedFileReader()");
+    if (m_options.cursor_buffer_size == 0) m_options.cursor_buffer_size = 1;
+    if (m_options.index_lines) {
+        // the cursor finds the line boundaries without parsing anything
+        Cursor cursor(this, 0);
+        std::string_view line;
+        for (uint64_t start = 0; cursor.next_line(line); start = cursor.offset())
+            m_line_starts.push_back(start);
+    }
+    if (m_options.name_index) m_name_index = NameIndex::load_or_build(path);
+}
+
+SharedFileReader::~SharedFileReader() noexcept = default;
+
+size_t SharedFileReader::read_bytes(uint64_t offset, char *out, size_t length) const {
+    std::lock_guard<std::mutex> lock(m_stream_mutex);
+    // a read that hit the end of the file leaves the stream failed, so clear that first
+    m_stream.clear();
+    m_stream.seekg(static_cast<std::streamoff>(offset));
+    m_stream.read(out, static_cast<std::streamsize>(length));
+    return static_cast<size_t>(m_stream.gcount());
+}
+#endif
+
+uint64_t SharedFileReader::line_start(size_t line, const char *caller) const {
+    if (!m_options.index_lines)
+        throw std::logic_error(std::string("SharedReaderOptions::index_lines is needed for ") + caller);
+    if (line >= m_line_starts.size())
+        throw std::out_of_range(std::string("Line number out of range in ") + caller);
+    return m_line_starts[line];
+}
+
+SharedFileReader::Cursor SharedFileReader::cursor(uint64_t offset) const {
+    return Cursor(this, offset);
+}
+
+SharedFileReader::Cursor SharedFileReader::cursor_at_line(size_t line) const {
+    return Cursor(this, line_start(line, "SharedFileReader::cursor_at_line()"));
+}
+
+std::optional<NamedValue> SharedFileReader::read_at(uint64_t offset) const {
+    return Cursor(this, offset).next();
+}
+
+NamedValue SharedFileReader::read_line(size_t line) const {
+    std::optional<NamedValue> value = Cursor(this, line_start(line, "SharedFileReader::read_line()")).next();
+    if (!value.has_value())
+        throw std::out_of_range("Line number out of range in SharedFileReader::read_line()");
+    return std::move(value.value());
+}
+
+size_t SharedFileReader::line_count() const {
+    if (!m_options.index_lines)
+        throw std::logic_error("SharedReaderOptions::index_lines is needed for SharedFileReader::line_count()");
+    return m_line_starts.size();
+}
+
+std::optional<Value> SharedFileReader::value_with_name(std::string_view name) const {
+    NamedValue current("", Value(0));
+    if (m_name_index.has_value()) {
+        std::optional<Value> found = std::nullopt;
+        m_name_index->for_each_candidate(name, [&](NameIndex::Location location) {
+            Cursor cursor(this, location.offset);
+            if (!cursor.next_into(current) || current.name_ref() != name) return false;
+            found = std::move(current).value();
+            return true;
+        });
+        return found;
+    }
+
+    Cursor cursor(this, 0);
+    while (cursor.next_into(current)) {
+        if (current.name_ref() == name) return std::move(current).value();
+    }
+    return std::nullopt;
+}
+
+std::vector<NamedValue> SharedFileReader::all() const {
+    std::vector<NamedValue> values{};
+    Cursor cursor(this, 0);
+    NamedValue current("", Value(0));
+    while (cursor.next_into(current)) values.push_back(std::move(current));
+    return values;
+}
+
+SharedFileReader::Cursor::Cursor(const SharedFileReader *reader, uint64_t offset)
+    : m_reader(reader), m_buffer_offset(offset), m_buffer(), m_position(0), m_spare() {}
+
+bool SharedFileReader::Cursor::next_line(std::string_view& line) {
+    size_t searched = m_position;
+    for (;;) {
+        size_t newline = m_buffer.find('\n', searched);
+        if (newline != std::string::npos) {
+            line = std::string_view(m_buffer.data() + m_position, newline - m_position);
+            m_position = newline + 1;
+            return true;
+        }
+
+        // drop the lines already read, then read more after the partial one
+        m_buffer.erase(0, m_position);
+        m_buffer_offset += m_position;
+        m_position = 0;
+        searched = m_buffer.size();
+        size_t chunk = m_reader->m_options.cursor_buffer_size;
+        m_buffer.resize(searched + chunk);
+        size_t count = m_reader->read_bytes(m_buffer_offset + searched, m_buffer.data() + searched, chunk);
+        m_buffer.resize(searched + count);
+        if (count == 0) {
+            // the last line of a file doesn't need a newline
+            if (m_buffer.empty()) return false;
+            line = std::string_view(m_buffer);
+            m_position = m_buffer.size();
+            return true;
+        }
+    }
+}
+
+bool SharedFileReader::Cursor::next_into(NamedValue& out) {
+    std::string_view line;
+    if (!next_line(line)) return false;
+    if (!parse_unsplit_line(line.data(), line.size(), out, m_spare))
+        throw std::runtime_error("Invalid pyson value encountered in SharedFileReader::Cursor::next()");
+    return true;
+}
+
+std::optional<NamedValue> SharedFileReader::Cursor::next() {
+    NamedValue out("", Value(0));
+    if (next_into(out)) return out;
+    return std::nullopt;
+}
+
+void SharedFileReader::Cursor::seek(uint64_t offset) {
+    m_buffer_offset = offset;
+    m_buffer.clear();
+    m_position = 0;
+}
+
+void SharedFileReader::Cursor::go_to_line(size_t line) {
+    seek(m_reader->line_start(line, "SharedFileReader::Cursor::go_to_line()"));
+}
+
+namespace {
+
+// A path next to `path` for a file that gets renamed over it when it's complete.
+// Two writers replacing the same file, in this process or another, each get their own.
+std::string temporary_path(const std::string& path) {
+    static std::atomic<uint64_t> counter{0};
+#if POSIX_FUNCTIONS_AVAILABLE
+    static const uint64_t process = static_cast<uint64_t>(getpid());
+#else
+    static const uint64_t process = (static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}();
+#endif
+    return path + ".tmp." + std::to_string(process) + "." + std::to_string(counter.fetch_add(1, std::memory_order_relaxed));
+}
+
+}
+
+FileWriter::FileWriter(const char *path, WriterOptions options)
+    : m_path(path),
+      m_write_path(options.atomic_replace ? temporary_path(m_path) : m_path),
+      m_handle(std::fopen(m_write_path.c_str(), "wb")),
+      m_buffer(),
+      m_options(options) {
+    if (m_handle == nullptr) {
+        throw std::runtime_error(
+            "fopen() IO error code "
+            + std::to_string(errno)
+            + " in FileWriter::FileWriter()"
+        );
+    }
+    m_buffer.reserve(m_options.buffer_size);
+}
+
+FileWriter::~FileWriter() noexcept {
+    if (m_handle == nullptr) return;
+    if (m_options.atomic_replace) {
+        close();
+        std::remove(m_write_path.c_str());
+        return;
+    }
+    try { flush(); } catch (...) {}
+    close();
+}
+
+bool FileWriter::close() noexcept {
+    bool closed = std::fclose(m_handle) == 0;
+    m_handle = nullptr;
+    return closed;
+}
+
+// Format name:type:value into the buffer without going through a stream
+void FileWriter::append_line(std::string_view name, const Value& value) {
+    if (name.find_first_of(":\n") != std::string_view::npos)
+        throw std::runtime_error("Name with ':' or newline in FileWriter::write()");
+
+    switch (value.type()) {
+        case PysonType::PysonInt:
+        case PysonType::PysonFloat:
+            break;
+        case PysonType::PysonStr:
+            if (value.m_value.m_str.find('\n') != std::string::npos)
+                throw std::runtime_error("String with newline in FileWriter::write()");
+            break;
+        case PysonType::PysonList: {
+            // only write lists that split back into the same elements
+            const std::vector<std::string>& list = value.m_value.m_list;
+            if (list.empty())
+                throw std::runtime_error("Empty list in FileWriter::write()");
+            for (size_t i = 0; i < list.size(); i++) {
+                std::string_view element = list[i];
+                if (element.find('\n') != std::string_view::npos)
+                    throw std::runtime_error("List element with newline in FileWriter::write()");
+                if (element.find("(*)") != std::string_view::npos)
+                    throw std::runtime_error("List element with \"(*)\" in FileWriter::write()");
+                if (element.empty() && i + 1 != list.size())
+                    throw std::runtime_error("Empty list element before the last in FileWriter::write()");
+            }
+            break;
+        }
+    }
+
+    m_buffer.append(name);
+    m_buffer.push_back(':');
+    m_buffer.append(value.type_cstring());
+    m_buffer.push_back(':');
+    value.serialize_to(m_buffer);
+    m_buffer.push_back('\n');
+}
+
+void FileWriter::flush_if_full() {
+    if (m_buffer.size() >= m_options.buffer_size) flush();
+}
+
+void FileWriter::write(std::string_view name, const Value& value) {
+    if (m_handle == nullptr)
+        throw std::logic_error("Tried to write after FileWriter::commit()");
+    size_t line_start = m_buffer.size();
+    try { append_line(name, value); }
+    catch (...) {
+        // don't leave half a line in the buffer
+        m_buffer.resize(line_start);
+        throw;
+    }
+    flush_if_full();
+}
+
+void FileWriter::write_batch(std::span<const NamedValue> values) {
+    for (const NamedValue& value : values)
+        write(value.m_name, value.m_value);
+}
+
+void FileWriter::flush() {
+    if (m_handle == nullptr || m_buffer.empty()) return;
+    size_t written = std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_handle);
+    if (written != m_buffer.size()) {
+        throw std::runtime_error(
+            "fwrite() IO error code "
+            + std::to_string(errno)
+            + " in FileWriter::flush()"
+        );
+    }
+    m_buffer.clear();
+}
+
+void FileWriter::commit() {
+    if (m_handle == nullptr)
+        throw std::logic_error("FileWriter::commit() called twice");
+    flush();
+    if (std::fflush(m_handle) != 0) {
+        throw std::runtime_error(
+            "fflush() IO error code "
+            + std::to_string(errno)
+            + " in FileWriter::commit()"
+        );
+    }
+#if POSIX_FUNCTIONS_AVAILABLE
+    // the data has to be on disk before the rename is, or a crash could leave an empty file
+    if (m_options.atomic_replace && fsync(fileno(m_handle)) != 0) {
+        throw std::runtime_error(
+            "fsync() IO error code "
+            + std::to_string(errno)
+            + " in FileWriter::commit()"
+        );
+    }
+#endif
+    if (!close())
+        throw std::runtime_error("fclose() IO error in FileWriter::commit()");
+
+    if (m_options.atomic_replace) {
+        std::error_code error;
+        std::filesystem::rename(m_write_path, m_path, error);
+        if (error) {
+            std::remove(m_write_path.c_str());
+            throw std::runtime_error(
+                "Error renaming " + m_write_path + " to " + m_path
+                + " in FileWriter::commit(): " + error.message()
+            );
+        }
+    }
+}
+
+#if POSIX_FUNCTIONS_AVAILABLE
+namespace {
+
+#ifdef __linux__
+constexpr uint32_t follow_events = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF;
+#endif
+
+}
+
+FollowReader::FollowReader(const char *path, FollowOptions options)
+    : m_path(path), m_options(options), m_fd(-1), m_notify_fd(-1), m_watch(-1),
+      m_read_offset(0), m_pending(), m_pending_start(0), m_spare() {
+    if (m_options.read_size == 0) m_options.read_size = 1;
+    m_fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (m_fd == -1) {
+        throw std::runtime_error(
+            "open() IO error code "
+            + std::to_string(errno)
+            + " in FollowReader::FollowReader()"
+        );
+    }
+#ifdef __linux__
+    // without inotify, wait() falls back to checking the file every poll_interval
+    m_notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_notify_fd != -1) m_watch = inotify_add_watch(m_notify_fd, path, follow_events);
+#endif
+    if (options.start_offset == FollowOptions::end) {
+        struct stat info;
+        if (fstat(m_fd, &info) == 0) m_read_offset = static_cast<uint64_t>(info.st_size);
+    } else {
+        m_read_offset = options.start_offset;
+    }
+}
+
+FollowReader::~FollowReader() noexcept {
+    close(m_fd);
+    if (m_notify_fd != -1) close(m_notify_fd);
+}
+
+bool FollowReader::read_available() {
+    struct stat info;
+    if (fstat(m_fd, &info) == 0 && static_cast<uint64_t>(info.st_size) < m_read_offset) restart();
+
+    bool read_any = false;
+    for (;;) {
+        size_t old_size = m_pending.size();
+        m_pending.resize(old_size + m_options.read_size);
+        ssize_t count = pread(m_fd, m_pending.data() + old_size, m_options.read_size, static_cast<off_t>(m_read_offset));
+        if (count == -1 && errno == EINTR) {
+            m_pending.resize(old_size);
+            continue;
+        }
+        m_pending.resize(old_size + (count > 0 ? static_cast<size_t>(count) : 0));
+        if (count == -1) {
+            throw std::runtime_error(
+                "pread() IO error code "
+                + std::to_string(errno)
+                + " in FollowReader::read_available()"
+            );
+        }
+        m_read_offset += static_cast<uint64_t>(count);
+        read_any = read_any || count > 0;
+        // a short read means we're at the end for now
+        if (static_cast<size_t>(count) < m_options.read_size) return read_any;
+    }
+}
+
+bool FollowReader::read_more() {
+    if (read_available()) return true;
+    // only switch files once the old one has nothing left, so its last lines aren't lost
+    return reopen_if_replaced() && read_available();
+}
+
+bool FollowReader::file_changed() const {
+    struct stat opened, current;
+    if (fstat(m_fd, &opened) != 0) return false;
+    if (static_cast<uint64_t>(opened.st_size) != m_read_offset) return true;
+    if (stat(m_path.c_str(), &current) != 0) return false;
+    return current.st_ino != opened.st_ino || current.st_dev != opened.st_dev;
+}
+
+bool FollowReader::reopen_if_replaced() {
+    struct stat opened, current;
+    if (fstat(m_fd, &opened) != 0 || stat(m_path.c_str(), &current) != 0) return false;
+    if (current.st_ino == opened.st_ino && current.st_dev == opened.st_dev) return false;
+    int fd = open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return false;
+    close(m_fd);
+    m_fd = fd;
+#ifdef __linux__
+    if (m_notify_fd != -1) {
+        if (m_watch != -1) inotify_rm_watch(m_notify_fd, m_watch);
+        m_watch = inotify_add_watch(m_notify_fd, m_path.c_str(), follow_events);
+    }
+#endif
+    restart();
+    return true;
+}
+
+void FollowReader::drain_events() noexcept {
+#ifdef __linux__
+    alignas(struct inotify_event) char buffer[4096];
+    for (;;) {
+        ssize_t count = read(m_notify_fd, buffer, sizeof(buffer));
+        if (count <= 0) return;
+        for (ssize_t i = 0; i < count;) {
+            struct inotify_event event;
+            std::memcpy(&event, buffer + i, sizeof(event));
+            // the file is gone from the path, so poll until reopen_if_replaced() finds the new one
+            if (event.wd == m_watch && (event.mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) != 0) {
+                if ((event.mask & IN_IGNORED) == 0) inotify_rm_watch(m_notify_fd, m_watch);
+                m_watch = -1;
+            }
+            i += static_cast<ssize_t>(sizeof(struct inotify_event) + event.len);
+        }
+    }
+#endif
+}
+
+bool FollowReader::wait(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        if (file_changed()) return true;
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0) return false;
+
+        if (m_notify_fd != -1 && m_watch != -1) {
+            pollfd watch{m_notify_fd, POLLIN, 0};
+            int ready = ::poll(&watch, 1, static_cast<int>(std::min<std::chrono::milliseconds::rep>(remaining.count(), INT_MAX)));
+            if (ready > 0) {
+                drain_events();
+                return true;
+            }
+            if (ready == -1 && errno != EINTR) {
+                close(m_notify_fd);
+                m_notify_fd = -1;
+                m_watch = -1;
+            }
+            continue;
+        }
+        std::this_thread::sleep_for(std::min(remaining, m_options.poll_interval));
+    }
+}
 #else
-    if (m_stream.peek() == EOF)
-        return Iter(nullptr);
-    else return Iter(this);
+FollowReader::FollowReader(const char *path, FollowOptions options)
+    : m_path(path), m_options(options), m_file(path, std::ios::binary),
+      m_read_offset(0), m_pending(), m_pending_start(0), m_spare() {
+    if (m_options.read_size == 0) m_options.read_size = 1;
+    if (!m_file.is_open())
+        throw std::runtime_error("Couldn't open " + m_path + " in FollowReader::FollowReader()");
+    if (options.start_offset == FollowOptions::end) {
+        std::error_code error;
+        uint64_t size = std::filesystem::file_size(m_path, error);
+        if (!error) m_read_offset = size;
+    } else {
+        m_read_offset = options.start_offset;
+    }
+}
+
+FollowReader::~FollowReader() noexcept = default;
+
+bool FollowReader::read_available() {
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(m_path, error);
+    if (error) return false;
+    if (size < m_read_offset) restart();
+
+    bool read_any = false;
+    while (m_read_offset < size) {
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(size - m_read_offset, m_options.read_size));
+        size_t old_size = m_pending.size();
+        m_pending.resize(old_size + chunk);
+        // the stream hit the old end of the file last time, so clear that before seeking past it
+        m_file.clear();
+        m_file.seekg(static_cast<std::streamoff>(m_read_offset));
+        m_file.read(m_pending.data() + old_size, static_cast<std::streamsize>(chunk));
+        size_t count = static_cast<size_t>(m_file.gcount());
+        m_pending.resize(old_size + count);
+        m_read_offset += count;
+        read_any = read_any || count > 0;
+        if (count < chunk) break;
+    }
+    return read_any;
+}
+
+bool FollowReader::read_more() {
+    return read_available();
+}
+
+bool FollowReader::file_changed() const {
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(m_path, error);
+    return !error && size != m_read_offset;
+}
+
+bool FollowReader::wait(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        if (file_changed()) return true;
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0) return false;
+        std::this_thread::sleep_for(std::min(remaining, m_options.poll_interval));
+    }
+}
 #endif
+
+void FollowReader::restart() noexcept {
+    m_read_offset = 0;
+    m_pending.clear();
+    m_pending_start = 0;
 }
 
-void FileReader::Iter::operator++() {
-    if (m_reader == nullptr)
+std::optional<std::string_view> FollowReader::take_line() {
+    size_t newline = m_pending.find('\n', m_pending_start);
+    if (newline == std::string::npos) {
+        // only the partial last line is left, move it to the front before more is appended
+        m_pending.erase(0, m_pending_start);
+        m_pending_start = 0;
+        return std::nullopt;
+    }
+    std::string_view line(m_pending.data() + m_pending_start, newline - m_pending_start);
+    m_pending_start = newline + 1;
+    return line;
+}
+
+std::optional<NamedValue> FollowReader::try_next() {
+    std::optional<std::string_view> line = take_line();
+    if (!line.has_value() && read_more()) line = take_line();
+    if (!line.has_value()) return std::nullopt;
+
+    NamedValue out("", Value(0));
+    if (!parse_unsplit_line(line->data(), line->size(), out, m_spare))
+        throw std::runtime_error("Invalid pyson value encountered in FollowReader::try_next()");
+    return out;
+}
+
+std::optional<NamedValue> FollowReader::next(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        std::optional<NamedValue> value = try_next();
+        if (value.has_value()) return value;
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0 || !wait(remaining)) return std::nullopt;
+    }
+}
+
+size_t FollowReader::poll(std::vector<NamedValue>& out) {
+    read_more();
+    size_t count = 0;
+    for (std::optional<std::string_view> line = take_line(); line.has_value(); line = take_line()) {
+        out.emplace_back("", Value(0));
+        if (!parse_unsplit_line(line->data(), line->size(), out.back(), m_spare)) {
+            out.pop_back();
+            throw std::runtime_error("Invalid pyson value encountered in FollowReader::poll()");
+        }
+        count++;
+    }
+    return count;
+}
+
+// Returns "int", "float", "str", or "list"
+const char *ValueView::type_cstring() const noexcept {
+    return type_name(type());
+}
+
+Value ValueView::to_value() const {
+    switch (type()) {
+        case PysonType::PysonInt: return Value(m_int);
+        case PysonType::PysonFloat: return Value(m_float);
+        case PysonType::PysonStr: return Value(std::string(m_str));
+        case PysonType::PysonList: return Value(std::vector<std::string>(m_list.begin(), m_list.end()));
+    }
+    throw std::logic_error("Unknown PysonType in ValueView::to_value()");
+}
+
+Document::Storage::Storage(std::pmr::memory_resource *resource)
+    : arena(resource == nullptr ? std::make_unique<std::pmr::monotonic_buffer_resource>() : nullptr),
+      resource(resource == nullptr ? arena.get() : resource),
+      text(this->resource),
+      records(this->resource),
+      list_elements(this->resource) {}
+
+Document::Document(std::pmr::memory_resource *resource) : m_storage(std::make_unique<Storage>(resource)) {}
+
+// Fill in the records from the text, names and strings point straight into the text
+void Document::parse_text(const char *invalid_message) {
+    const std::pmr::string& text = m_storage->text;
+    std::pmr::vector<Record>& records = m_storage->records;
+    std::pmr::vector<std::string_view>& list_elements = m_storage->list_elements;
+    StructuralIndex index = StructuralIndex::build(text.data(), text.size());
+    records.reserve(index.line_count());
+    for (size_t i = 0; i < index.line_count(); i++) {
+        size_t first_colon = index.first_colons[i];
+        size_t second_colon = index.second_colons[i];
+        if (second_colon == StructuralIndex::npos) throw std::runtime_error(invalid_message);
+
+        Record record;
+        const char *tag = text.data() + first_colon + 1;
+        if (!parse_type_tag(tag, second_colon - first_colon - 1, record.type))
+            throw std::runtime_error(invalid_message);
+        record.name = std::string_view(text.data() + index.line_starts[i], first_colon - index.line_starts[i]);
+
+        const char *payload = text.data() + second_colon + 1;
+        size_t payload_length = index.line_ends[i] - second_colon - 1;
+        switch (record.type) {
+            case PysonType::PysonInt:
+                if (!parse_int(payload, payload_length, record.m_int)) throw std::runtime_error(invalid_message);
+                break;
+            case PysonType::PysonFloat:
+                if (!parse_float(payload, payload_length, record.m_float)) throw std::runtime_error(invalid_message);
+                break;
+            case PysonType::PysonStr:
+                record.m_str = std::string_view(payload, payload_length);
+                break;
+            case PysonType::PysonList: {
+                record.m_list.first = list_elements.size();
+                for_each_list_element(std::string_view(payload, payload_length), [&](std::string_view element) {
+                    list_elements.push_back(element);
+                });
+                record.m_list.count = list_elements.size() - record.m_list.first;
+                break;
+            }
+        }
+        records.push_back(record);
+    }
+}
+
+std::string_view Document::name(size_t i) const {
+    if (!m_storage) throw std::out_of_range("Moved-from Document in Document::name()");
+    return m_storage->records.at(i).name;
+}
+
+ValueView Document::value(size_t i) const {
+    if (!m_storage) throw std::out_of_range("Moved-from Document in Document::value()");
+    const Record& record = m_storage->records.at(i);
+    switch (record.type) {
+        case PysonType::PysonInt: return ValueView(record.m_int);
+        case PysonType::PysonFloat: return ValueView(record.m_float);
+        case PysonType::PysonStr: return ValueView(record.m_str);
+        case PysonType::PysonList:
+            return ValueView(std::span<const std::string_view>(
+                m_storage->list_elements.data() + record.m_list.first,
+                record.m_list.count
+            ));
+    }
+    throw std::logic_error("Unknown PysonType in Document::value()");
+}
+
+NamedValue Document::named_value(size_t i) const {
+    return NamedValue(std::string(name(i)), value(i).to_value());
+}
+
+std::optional<ValueView> Document::value_with_name(std::string_view name) const {
+    for (size_t i = 0; i < size(); i++) {
+        if (m_storage->records[i].name == name) return value(i);
+    }
+    return std::nullopt;
+}
+
+ColumnarTable::ColumnarTable(const Document& document) : m_list_offsets{0} {
+    if (document.size() > UINT32_MAX)
+        throw std::runtime_error("Too many values in ColumnarTable::ColumnarTable()");
+
+    // size everything first, so the payload never moves and views into it can be taken right away
+    size_t name_bytes = 0, payload_bytes = 0, element_count = 0;
+    size_t ints = 0, floats = 0, strs = 0, lists = 0;
+    for (size_t i = 0; i < document.size(); i++) {
+        name_bytes += document.name(i).size();
+        ValueView value = document.value(i);
+        switch (value.type()) {
+            case PysonType::PysonInt: ints++; break;
+            case PysonType::PysonFloat: floats++; break;
+            case PysonType::PysonStr: strs++; payload_bytes += value.string_or_throw().size(); break;
+            case PysonType::PysonList:
+                lists++;
+                for (std::string_view element : value.list_or_throw()) payload_bytes += element.size();
+                element_count += value.list_or_throw().size();
+                break;
+        }
+    }
+    m_types.reserve(document.size());
+    m_column_index.reserve(document.size());
+    m_names.reserve(name_bytes);
+    m_name_offsets.reserve(document.size() + 1);
+    m_ints.reserve(ints);
+    m_floats.reserve(floats);
+    m_payload.reserve(payload_bytes);
+    m_strings.reserve(strs);
+    m_list_offsets.reserve(lists + 1);
+    m_list_elements.reserve(element_count);
+
+    auto append_payload = [this](std::string_view text) {
+        const char *start = m_payload.data() + m_payload.size();
+        m_payload.insert(m_payload.end(), text.begin(), text.end());
+        return std::string_view(start, text.size());
+    };
+    m_name_offsets.push_back(0);
+    for (size_t i = 0; i < document.size(); i++) {
+        std::string_view name = document.name(i);
+        m_names.insert(m_names.end(), name.begin(), name.end());
+        m_name_offsets.push_back(m_names.size());
+
+        ValueView value = document.value(i);
+        m_types.push_back(value.type());
+        switch (value.type()) {
+            case PysonType::PysonInt:
+                m_column_index.push_back(static_cast<uint32_t>(m_ints.size()));
+                m_ints.push_back(value.int_or_throw());
+                break;
+            case PysonType::PysonFloat:
+                m_column_index.push_back(static_cast<uint32_t>(m_floats.size()));
+                m_floats.push_back(value.float_or_throw());
+                break;
+            case PysonType::PysonStr:
+                m_column_index.push_back(static_cast<uint32_t>(m_strings.size()));
+                m_strings.push_back(append_payload(value.string_or_throw()));
+                break;
+            case PysonType::PysonList:
+                m_column_index.push_back(static_cast<uint32_t>(m_list_offsets.size() - 1));
+                for (std::string_view element : value.list_or_throw())
+                    m_list_elements.push_back(append_payload(element));
+                m_list_offsets.push_back(m_list_elements.size());
+                break;
+        }
+    }
+}
+
+std::string_view ColumnarTable::name(size_t i) const {
+    if (i >= size()) throw std::out_of_range("Index out of range in ColumnarTable::name()");
+    return std::string_view(m_names.data() + m_name_offsets[i], m_name_offsets[i + 1] - m_name_offsets[i]);
+}
+
+ValueView ColumnarTable::value(size_t i) const {
+    if (i >= size()) throw std::out_of_range("Index out of range in ColumnarTable::value()");
+    size_t k = m_column_index[i];
+    switch (m_types[i]) {
+        case PysonType::PysonInt: return ValueView(m_ints[k]);
+        case PysonType::PysonFloat: return ValueView(m_floats[k]);
+        case PysonType::PysonStr: return ValueView(m_strings[k]);
+        case PysonType::PysonList: return ValueView(list(k));
+    }
+    throw std::logic_error("Unknown PysonType in ColumnarTable::value()");
+}
+
+NamedValue ColumnarTable::named_value(size_t i) const {
+    return NamedValue(std::string(name(i)), value(i).to_value());
+}
+
+std::optional<ValueView> ColumnarTable::value_with_name(std::string_view name) const {
+    for (size_t i = 0; i < size(); i++) {
+        if (this->name(i) == name) return value(i);
+    }
+    return std::nullopt;
+}
+
+std::span<const std::string_view> ColumnarTable::list(size_t k) const {
+    if (k >= list_count()) throw std::out_of_range("Index out of range in ColumnarTable::list()");
+    return std::span<const std::string_view>(m_list_elements).subspan(
+        m_list_offsets[k], m_list_offsets[k + 1] - m_list_offsets[k]
+    );
+}
+
+size_t ColumnarTable::count(PysonType type) const noexcept {
+    switch (type) {
+        case PysonType::PysonInt: return m_ints.size();
+        case PysonType::PysonFloat: return m_floats.size();
+        case PysonType::PysonStr: return m_strings.size();
+        case PysonType::PysonList: return list_count();
+    }
+    return 0;
+}
+
+FrozenMap::FrozenMap(std::vector<NamedValue> values) : FrozenMap() {
+    size_t name_bytes = 0;
+    for (const NamedValue& value : values) name_bytes += value.name_ref().size();
+    m_names.reserve(name_bytes);
+    m_name_offsets.reserve(values.size() + 1);
+    m_values.reserve(values.size());
+
+    size_t slot_count = 16;
+    while (slot_count < values.size() * 2) slot_count *= 2;
+    m_slots.assign(slot_count, Slot{0, 0});
+    for (NamedValue& value : values) {
+        std::string_view name = value.name_ref();
+        uint64_t hash = hash_name(name);
+        size_t i = hash & (slot_count - 1);
+        for (; m_slots[i].hash != 0; i = (i + 1) & (slot_count - 1)) {
+            if (m_slots[i].hash == hash && this->name(m_slots[i].index) == name)
+                throw std::runtime_error("Duplicate name encountered in FrozenMap::FrozenMap()");
+        }
+        m_slots[i] = Slot{hash, m_values.size()};
+        m_names.append(name);
+        m_name_offsets.push_back(m_names.size());
+        m_values.push_back(std::move(value).value());
+    }
+}
+
+const Value *FrozenMap::find(std::string_view name) const noexcept {
+    if (m_slots.empty()) return nullptr;
+    uint64_t hash = hash_name(name);
+    size_t mask = m_slots.size() - 1;
+    for (size_t i = hash & mask; m_slots[i].hash != 0; i = (i + 1) & mask) {
+        const Slot& slot = m_slots[i];
+        if (slot.hash != hash) continue;
+        size_t start = m_name_offsets[slot.index];
+        if (std::string_view(m_names.data() + start, m_name_offsets[slot.index + 1] - start) == name)
+            return &m_values[slot.index];
+    }
+    return nullptr;
+}
+
+const Value& FrozenMap::at(std::string_view name) const {
+    const Value *value = find(name);
+    if (value == nullptr) throw std::out_of_range("Name not found in FrozenMap::at()");
+    return *value;
+}
+
+std::string_view FrozenMap::name(size_t i) const {
+    if (i >= size()) throw std::out_of_range("Index out of range in FrozenMap::name()");
+    return std::string_view(m_names.data() + m_name_offsets[i], m_name_offsets[i + 1] - m_name_offsets[i]);
+}
+
+LiveConfig::LiveConfig(const char *path, LiveConfigOptions options)
+    : m_path(path), m_options(std::move(options)), m_current_mutex(), m_current(), m_generation(0),
+      m_reload_mutex(), m_loaded_size(0), m_loaded_mtime(0), m_failed_size(0), m_failed_mtime(0),
+      m_stop_mutex(), m_stop_condition(), m_stop(false), m_thread() {
+    uint64_t size;
+    int64_t mtime;
+    if (!source_stamp(path, size, mtime))
+        throw std::runtime_error("Couldn't read file size or modification time in LiveConfig::LiveConfig()");
+    load(size, mtime);
+    if (m_options.check_interval.count() > 0) m_thread = std::thread([this] { watch(); });
+}
+
+LiveConfig::~LiveConfig() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(m_stop_mutex);
+        m_stop = true;
+    }
+    m_stop_condition.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void LiveConfig::load(uint64_t size, int64_t mtime) {
+    std::shared_ptr<const FrozenMap> next = std::make_shared<const FrozenMap>(FileReader(m_path).as_frozen_map());
+    {
+        std::lock_guard<std::mutex> lock(m_current_mutex);
+        m_current.swap(next);
+    }
+    // readers see the new generation only after the new snapshot is in place
+    m_generation.fetch_add(1, std::memory_order_release);
+    m_loaded_size = size;
+    m_loaded_mtime = mtime;
+    // `next` now holds the old snapshot, which is freed here (outside the lock) unless a reader still has it
+}
+
+void LiveConfig::watch() {
+    std::unique_lock<std::mutex> stop_lock(m_stop_mutex);
+    while (!m_stop_condition.wait_for(stop_lock, m_options.check_interval, [this] { return m_stop; })) {
+        stop_lock.unlock();
+        std::exception_ptr error = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_reload_mutex);
+            uint64_t size;
+            int64_t mtime;
+            // a missing file is usually one that's being replaced, so just check again next time
+            bool changed = source_stamp(m_path.c_str(), size, mtime)
+                && (size != m_loaded_size || mtime != m_loaded_mtime)
+                && (size != m_failed_size || mtime != m_failed_mtime);
+            if (changed) {
+                try {
+                    load(size, mtime);
+                } catch (...) {
+                    m_failed_size = size;
+                    m_failed_mtime = mtime;
+                    error = std::current_exception();
+                }
+            }
+        }
+        // outside the lock, so on_error can call reload()
+        if (error != nullptr && m_options.on_error) {
+            try { std::rethrow_exception(error); }
+            catch (const std::exception& e) { m_options.on_error(e); }
+            catch (...) {}
+        }
+        stop_lock.lock();
+    }
+}
+
+std::shared_ptr<const FrozenMap> LiveConfig::snapshot() const {
+    std::lock_guard<std::mutex> lock(m_current_mutex);
+    return m_current;
+}
+
+LiveConfig::Reader LiveConfig::reader() const {
+    return Reader(this);
+}
+
+LiveConfig::Reader::Reader(const LiveConfig *config)
+    : m_config(config), m_generation(config->generation()), m_snapshot(config->snapshot()) {}
+
+std::optional<Value> LiveConfig::get(std::string_view name) const {
+    std::shared_ptr<const FrozenMap> current = snapshot();
+    const Value *value = current->find(name);
+    if (value == nullptr) return std::nullopt;
+    return *value;
+}
+
+void LiveConfig::reload() {
+    std::lock_guard<std::mutex> lock(m_reload_mutex);
+    uint64_t size;
+    int64_t mtime;
+    if (!source_stamp(m_path.c_str(), size, mtime))
+        throw std::runtime_error("Couldn't read file size or modification time in LiveConfig::reload()");
+    load(size, mtime);
+}
+
+bool LiveConfig::reload_if_changed() {
+    std::lock_guard<std::mutex> lock(m_reload_mutex);
+    uint64_t size;
+    int64_t mtime;
+    if (!source_stamp(m_path.c_str(), size, mtime))
+        throw std::runtime_error("Couldn't read file size or modification time in LiveConfig::reload_if_changed()");
+    if (size == m_loaded_size && mtime == m_loaded_mtime) return false;
+    load(size, mtime);
+    return true;
+}
+
+namespace {
+
+// A pool of threads that each have a deque of tasks. A thread runs the tasks at the back of its own deque,
+// and when it runs out it steals from the front of the others'. Tasks can push more tasks while running.
+class WorkStealingPool {
+public:
+    // Gets the index of the thread running it, to push follow-up tasks onto
+    using Task = std::function<void(size_t)>;
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<Queue> m_queues;
+    // Tasks pushed but not finished yet, the threads stop once this is 0
+    std::atomic<size_t> m_unfinished;
+    // Threads with nothing to take sleep on m_wake until there's a new push or everything is done
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake;
+    // Number of pushes so far, so a thread can tell if one happened since it last looked
+    uint64_t m_pushes;
+
+    std::optional<Task> take(size_t thread) {
+        {
+            Queue& own = m_queues[thread];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                Task task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return task;
+            }
+        }
+        for (size_t i = 1; i < m_queues.size(); i++) {
+            Queue& victim = m_queues[(thread + i) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                Task task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return task;
+            }
+        }
+        return std::nullopt;
+    }
+
+public:
+    explicit WorkStealingPool(size_t threads)
+        : m_queues(std::max<size_t>(threads, 1)), m_unfinished(0), m_wake_mutex(), m_wake(), m_pushes(0) {}
+
+    size_t threads() const noexcept { return m_queues.size(); }
+
+    void push(size_t thread, Task task) {
+        m_unfinished.fetch_add(1, std::memory_order_relaxed);
+        {
+            Queue& queue = m_queues[thread];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_wake_mutex);
+            m_pushes++;
+        }
+        m_wake.notify_one();
+    }
+
+    // Run every task on threads() threads (this one included), tasks must not throw
+    void run() {
+        run_on_threads(m_queues.size(), [this](size_t thread) {
+            for (;;) {
+                // look at the push count before looking for a task, so a push in between isn't missed
+                uint64_t pushes;
+                {
+                    std::lock_guard<std::mutex> lock(m_wake_mutex);
+                    pushes = m_pushes;
+                }
+                std::optional<Task> task = take(thread);
+                if (task.has_value()) {
+                    (*task)(thread);
+                    if (m_unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                        // that was the last task, wake everyone so they can stop
+                        { std::lock_guard<std::mutex> lock(m_wake_mutex); }
+                        m_wake.notify_all();
+                    }
+                    continue;
+                }
+
+                // someone is still running a task that might push more, sleep until it does or finishes
+                std::unique_lock<std::mutex> lock(m_wake_mutex);
+                m_wake.wait(lock, [&] {
+                    return m_pushes != pushes || m_unfinished.load(std::memory_order_acquire) == 0;
+                });
+                if (m_unfinished.load(std::memory_order_acquire) == 0) return;
+            }
+        });
+    }
+};
+
+// One file of load_many(), and the chunks it's split into while it's being parsed
+struct LoadJob {
+    LoadResult *result;
+    uint64_t size;
+    std::optional<FileMapping> mapping;
+    std::vector<std::string_view> chunks;
+    std::vector<std::vector<NamedValue>> parts;
+    std::vector<std::string> chunk_errors;
+    // Chunks not parsed yet, whoever parses the last one builds the map
+    std::atomic<size_t> remaining;
+};
+
+constexpr const char *load_many_invalid_message = "Invalid pyson value encountered in pyson::load_many()";
+
+std::string current_error_message() {
+    try {
+        throw;
+    } catch (const std::exception& e) {
+        return e.what();
+    } catch (...) {
+        return "Unknown exception in pyson::load_many()";
+    }
+}
+
+// Stitch the parsed chunks of a file together into its map, and let go of the file
+void finish_load(LoadJob& job) noexcept {
+    try {
+        for (std::string& error : job.chunk_errors) {
+            if (!error.empty()) {
+                job.result->error = std::move(error);
+                break;
+            }
+        }
+        if (job.result->ok()) {
+            std::vector<NamedValue> values{};
+            size_t total = 0;
+            for (const std::vector<NamedValue>& part : job.parts) total += part.size();
+            values.reserve(total);
+            for (std::vector<NamedValue>& part : job.parts)
+                std::move(part.begin(), part.end(), std::back_inserter(values));
+            job.result->values = FrozenMap(std::move(values));
+        }
+    } catch (...) {
+        job.result->error = current_error_message();
+    }
+    job.parts.clear();
+    job.chunks.clear();
+    job.mapping.reset();
+}
+
+void parse_load_chunk(LoadJob& job, size_t i) noexcept {
+    try {
+        parse_buffer(job.chunks[i], job.parts[i], load_many_invalid_message);
+    } catch (...) {
+        job.chunk_errors[i] = current_error_message();
+    }
+    if (job.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) finish_load(job);
+}
+
+void start_load(WorkStealingPool& pool, size_t thread, LoadJob& job, ParallelOptions options) noexcept {
+    try {
+        job.mapping.emplace(job.result->path.c_str(), MapOptions{});
+        std::string_view contents(job.mapping->data(), job.mapping->size());
+        job.chunks = split_into_chunks(contents, options);
+        job.parts.resize(job.chunks.size());
+        job.chunk_errors.resize(job.chunks.size());
+    } catch (...) {
+        job.result->error = current_error_message();
+        job.mapping.reset();
         return;
-    auto opt = m_reader->next();
-    if (!opt.has_value()) {
-        m_reader = nullptr;
+    }
+    if (job.chunks.size() <= 1) {
+        // an empty file has no chunks at all
+        job.remaining.store(job.chunks.size(), std::memory_order_relaxed);
+        if (job.chunks.empty()) finish_load(job);
+        else parse_load_chunk(job, 0);
         return;
     }
-    m_cached = opt.value();
+
+    job.remaining.store(job.chunks.size(), std::memory_order_relaxed);
+    // the other chunks go where idle threads can steal them, this thread starts on the first
+    for (size_t i = job.chunks.size() - 1; i > 0; i--) {
+        try {
+            pool.push(thread, [&job, i](size_t) { parse_load_chunk(job, i); });
+        } catch (...) {
+            parse_load_chunk(job, i);
+        }
+    }
+    parse_load_chunk(job, 0);
 }
 
-NamedValue FileReader::Iter::operator*() {
-    if (m_reader == nullptr)
-        throw std::logic_error("Tried to dereference finished FileReader::Iter iterator");
-    
-    return m_cached;
 }
 
-bool FileReader::Iter::operator!=(const End& end) {
-    (void)end;
-    return m_reader != nullptr;
+std::vector<LoadResult> load_many(std::span<const std::string> paths, ParallelOptions options) {
+    std::vector<LoadResult> results(paths.size());
+    if (paths.empty()) return results;
+    std::vector<LoadJob> jobs(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+        results[i].path = paths[i];
+        jobs[i].result = &results[i];
+        std::error_code error;
+        uint64_t size = std::filesystem::file_size(paths[i], error);
+        jobs[i].size = error ? 0 : size;
+    }
+
+    size_t threads = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+    WorkStealingPool pool(threads);
+    // chunks are split for the pool's threads, not for however many threads the caller asked for
+    options.threads = static_cast<unsigned>(pool.threads());
+
+    // deal the files out smallest first, so every thread starts at the back with its biggest ones
+    std::vector<LoadJob *> order;
+    order.reserve(jobs.size());
+    for (LoadJob& job : jobs) order.push_back(&job);
+    std::stable_sort(order.begin(), order.end(), [](const LoadJob *a, const LoadJob *b) { return a->size < b->size; });
+    for (size_t i = 0; i < order.size(); i++) {
+        LoadJob *job = order[i];
+        pool.push(i % pool.threads(), [&pool, job, options](size_t thread) { start_load(pool, thread, *job, options); });
+    }
+    pool.run();
+    return results;
+}
+
+namespace {
+
+// Compiled file layout, all native-endian:
+//   the header
+//   record_count records
+//   element_count list elements: offset and length of each element in the blob
+//   slot_count index slots: name hash (0 for an empty slot) and record number + 1
+//   blob_size bytes of names, strings and list elements
+constexpr char binary_magic[8] = {'P', 'Y', 'S', 'O', 'N', 'B', '0', '1'};
+// Reads back differently on a machine with another byte order
+constexpr uint64_t binary_byte_order = 0x0102030405060708ull;
+
+struct BinaryHeader {
+    char magic[8];
+    uint64_t byte_order;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t record_count;
+    uint64_t element_count;
+    uint64_t slot_count;
+    uint64_t blob_size;
+};
+
+struct BinaryRecord {
+    uint64_t name_offset;
+    uint32_t name_length;
+    uint8_t type;
+    uint8_t padding[3];
+    // int: the int's bits, float: the double's bits,
+    // str: offset and length in the blob, list: first element and number of elements
+    uint64_t first;
+    uint64_t second;
+};
+
+struct BinaryElement {
+    uint64_t offset;
+    uint64_t length;
+};
+
+struct BinarySlot {
+    uint64_t hash;
+    uint64_t record;
+};
+
+static_assert(sizeof(BinaryHeader) == 64 && sizeof(BinaryRecord) == 32
+    && sizeof(BinaryElement) == 16 && sizeof(BinarySlot) == 16, "Unexpected padding in the compiled pyson layout");
+
+// Copy entry i of a table out of the mapping, which might not be aligned for T
+template <class T>
+T read_entry(const char *table, size_t i) noexcept {
+    T entry;
+    std::memcpy(&entry, table + i * sizeof(T), sizeof(T));
+    return entry;
+}
+
+// Whether [offset, offset + length) fits in size, without overflowing
+bool in_bounds(uint64_t offset, uint64_t length, uint64_t size) noexcept {
+    return offset <= size && length <= size - offset;
+}
+
+template <class T>
+void write_table(std::ofstream& out, const std::vector<T>& table) {
+    out.write(reinterpret_cast<const char *>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(T)));
+}
+
+}
+
+void compile(const char *text_path, const char *bin_path) {
+    BinaryHeader header{};
+    std::memcpy(header.magic, binary_magic, sizeof(header.magic));
+    header.byte_order = binary_byte_order;
+    if (!source_stamp(text_path, header.source_size, header.source_mtime))
+        throw std::runtime_error("Couldn't read file size or modification time in pyson::compile()");
+    Document document = FileReader(text_path).load_document();
+
+    std::vector<BinaryRecord> records(document.size());
+    std::vector<BinaryElement> elements;
+    std::string blob;
+    auto append_blob = [&blob](std::string_view text) {
+        BinaryElement element{blob.size(), text.size()};
+        blob.append(text);
+        return element;
+    };
+    for (size_t i = 0; i < document.size(); i++) {
+        BinaryRecord& record = records[i];
+        std::string_view name = document.name(i);
+        if (name.size() > UINT32_MAX)
+            throw std::runtime_error("Name too long in pyson::compile()");
+        record.name_offset = append_blob(name).offset;
+        record.name_length = static_cast<uint32_t>(name.size());
+
+        ValueView value = document.value(i);
+        record.type = static_cast<uint8_t>(value.type());
+        switch (value.type()) {
+            case PysonType::PysonInt:
+                record.first = static_cast<uint32_t>(value.int_or_throw());
+                break;
+            case PysonType::PysonFloat: {
+                double number = value.float_or_throw();
+                std::memcpy(&record.first, &number, sizeof(number));
+                break;
+            }
+            case PysonType::PysonStr: {
+                BinaryElement str = append_blob(value.string_or_throw());
+                record.first = str.offset;
+                record.second = str.length;
+                break;
+            }
+            case PysonType::PysonList:
+                record.first = elements.size();
+                record.second = value.list_or_throw().size();
+                for (std::string_view element : value.list_or_throw())
+                    elements.push_back(append_blob(element));
+                break;
+        }
+    }
+
+    // the same open addressing as NameIndex, keeping the first record for each name
+    size_t slot_count = 16;
+    while (slot_count < records.size() * 2) slot_count *= 2;
+    std::vector<BinarySlot> slots(slot_count, BinarySlot{0, 0});
+    std::unordered_set<std::string_view> seen;
+    for (size_t i = 0; i < document.size(); i++) {
+        if (!seen.insert(document.name(i)).second) continue;
+        uint64_t hash = hash_name(document.name(i));
+        size_t slot = hash & (slot_count - 1);
+        while (slots[slot].hash != 0) slot = (slot + 1) & (slot_count - 1);
+        slots[slot] = BinarySlot{hash, i + 1};
+    }
+
+    header.record_count = records.size();
+    header.element_count = elements.size();
+    header.slot_count = slot_count;
+    header.blob_size = blob.size();
+
+    // write next to the real file and rename, so a reader never maps a half-written file
+    std::string path(bin_path);
+    std::string write_path = temporary_path(path);
+    std::ofstream out(write_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    write_table(out, records);
+    write_table(out, elements);
+    write_table(out, slots);
+    out.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+    out.close();
+    if (!out) {
+        std::remove(write_path.c_str());
+        throw std::runtime_error("Error writing " + write_path + " in pyson::compile()");
+    }
+    std::error_code error;
+    std::filesystem::rename(write_path, path, error);
+    if (error) {
+        std::remove(write_path.c_str());
+        throw std::runtime_error(
+            "Error renaming " + write_path + " to " + path
+            + " in pyson::compile(): " + error.message()
+        );
+    }
+}
+
+BinaryReader::BinaryReader(const char *path, MapOptions options)
+    : m_mapping(path, options), m_record_count(0), m_slot_count(0), m_slots_offset(0),
+      m_blob_offset(0), m_source_size(0), m_source_mtime(0), m_list_elements() {
+    validate();
+}
+
+void BinaryReader::validate() {
+    const char *data = m_mapping.data();
+    uint64_t size = m_mapping.size();
+    if (size < sizeof(BinaryHeader))
+        throw std::runtime_error("Not a compiled pyson file in BinaryReader::BinaryReader()");
+    BinaryHeader header = read_entry<BinaryHeader>(data, 0);
+    if (std::memcmp(header.magic, binary_magic, sizeof(header.magic)) != 0)
+        throw std::runtime_error("Not a compiled pyson file in BinaryReader::BinaryReader()");
+    if (header.byte_order != binary_byte_order)
+        throw std::runtime_error("Compiled pyson file with a different byte order in BinaryReader::BinaryReader()");
+
+    const char *corrupt = "Corrupt compiled pyson file in BinaryReader::BinaryReader()";
+    // each table has to fit in what's left after the ones before it, and the blob is the rest
+    uint64_t remaining = size - sizeof(BinaryHeader);
+    if (header.record_count > remaining / sizeof(BinaryRecord)) throw std::runtime_error(corrupt);
+    remaining -= header.record_count * sizeof(BinaryRecord);
+    if (header.element_count > remaining / sizeof(BinaryElement)) throw std::runtime_error(corrupt);
+    remaining -= header.element_count * sizeof(BinaryElement);
+    if (header.slot_count > remaining / sizeof(BinarySlot)) throw std::runtime_error(corrupt);
+    remaining -= header.slot_count * sizeof(BinarySlot);
+    if (header.blob_size != remaining) throw std::runtime_error(corrupt);
+    if (header.slot_count <= header.record_count || (header.slot_count & (header.slot_count - 1)) != 0)
+        throw std::runtime_error(corrupt);
+
+    m_record_count = header.record_count;
+    m_slot_count = header.slot_count;
+    size_t elements_offset = sizeof(BinaryHeader) + m_record_count * sizeof(BinaryRecord);
+    m_slots_offset = elements_offset + header.element_count * sizeof(BinaryElement);
+    m_blob_offset = m_slots_offset + m_slot_count * sizeof(BinarySlot);
+    m_source_size = header.source_size;
+    m_source_mtime = header.source_mtime;
+
+    const char *blob = data + m_blob_offset;
+    m_list_elements.reserve(header.element_count);
+    for (size_t i = 0; i < header.element_count; i++) {
+        BinaryElement element = read_entry<BinaryElement>(data + elements_offset, i);
+        if (!in_bounds(element.offset, element.length, header.blob_size)) throw std::runtime_error(corrupt);
+        m_list_elements.emplace_back(blob + element.offset, element.length);
+    }
+
+    const char *records = data + sizeof(BinaryHeader);
+    for (size_t i = 0; i < m_record_count; i++) {
+        BinaryRecord record = read_entry<BinaryRecord>(records, i);
+        if (!in_bounds(record.name_offset, record.name_length, header.blob_size)) throw std::runtime_error(corrupt);
+        switch (static_cast<PysonType>(record.type)) {
+            case PysonType::PysonInt:
+            case PysonType::PysonFloat:
+                break;
+            case PysonType::PysonStr:
+                if (!in_bounds(record.first, record.second, header.blob_size)) throw std::runtime_error(corrupt);
+                break;
+            case PysonType::PysonList:
+                if (!in_bounds(record.first, record.second, header.element_count)) throw std::runtime_error(corrupt);
+                break;
+            default:
+                throw std::runtime_error(corrupt);
+        }
+    }
+
+    // lookups stop at an empty slot, so there has to be one
+    bool has_empty = false;
+    for (size_t i = 0; i < m_slot_count; i++) {
+        BinarySlot slot = read_entry<BinarySlot>(data + m_slots_offset, i);
+        if (slot.hash == 0) has_empty = true;
+        else if (slot.record == 0 || slot.record > m_record_count) throw std::runtime_error(corrupt);
+    }
+    if (!has_empty) throw std::runtime_error(corrupt);
+}
+
+BinaryReader BinaryReader::open_or_compile(const char *text_path, const char *bin_path, MapOptions options) {
+    std::error_code error;
+    if (std::filesystem::exists(bin_path, error)) {
+        try {
+            BinaryReader reader(bin_path, options);
+            if (reader.is_compiled_from(text_path)) return reader;
+        } catch (const std::runtime_error&) {
+            // unreadable, corrupt or from another machine, compile it again
+        }
+    }
+    compile(text_path, bin_path);
+    return BinaryReader(bin_path, options);
+}
+
+bool BinaryReader::is_compiled_from(const char *text_path) const {
+    uint64_t size;
+    int64_t mtime;
+    if (!source_stamp(text_path, size, mtime)) return false;
+    return size == m_source_size && mtime == m_source_mtime;
+}
+
+std::string_view BinaryReader::name(size_t i) const {
+    if (i >= m_record_count) throw std::out_of_range("Index out of range in BinaryReader::name()");
+    BinaryRecord record = read_entry<BinaryRecord>(m_mapping.data() + sizeof(BinaryHeader), i);
+    return std::string_view(m_mapping.data() + m_blob_offset + record.name_offset, record.name_length);
+}
+
+ValueView BinaryReader::value(size_t i) const {
+    if (i >= m_record_count) throw std::out_of_range("Index out of range in BinaryReader::value()");
+    BinaryRecord record = read_entry<BinaryRecord>(m_mapping.data() + sizeof(BinaryHeader), i);
+    switch (static_cast<PysonType>(record.type)) {
+        case PysonType::PysonInt:
+            return ValueView(static_cast<int>(static_cast<uint32_t>(record.first)));
+        case PysonType::PysonFloat: {
+            double number;
+            std::memcpy(&number, &record.first, sizeof(number));
+            return ValueView(number);
+        }
+        case PysonType::PysonStr:
+            return ValueView(std::string_view(m_mapping.data() + m_blob_offset + record.first, record.second));
+        case PysonType::PysonList:
+            return ValueView(std::span<const std::string_view>(
+                m_list_elements.data() + record.first,
+                record.second
+            ));
+    }
+    throw std::logic_error("Unknown PysonType in BinaryReader::value()");
+}
+
+NamedValue BinaryReader::named_value(size_t i) const {
+    return NamedValue(std::string(name(i)), value(i).to_value());
+}
+
+std::optional<size_t> BinaryReader::find(std::string_view name) const {
+    uint64_t hash = hash_name(name);
+    size_t mask = m_slot_count - 1;
+    const char *slots = m_mapping.data() + m_slots_offset;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        BinarySlot slot = read_entry<BinarySlot>(slots, i);
+        if (slot.hash == 0) return std::nullopt;
+        if (slot.hash == hash && this->name(slot.record - 1) == name) return slot.record - 1;
+    }
+}
+
+std::optional<ValueView> BinaryReader::value_with_name(std::string_view name) const {
+    std::optional<size_t> i = find(name);
+    if (!i.has_value()) return std::nullopt;
+    return value(*i);
 }
 
-}
\ No newline at end of file
+std::string BindResult::message() const {
+    std::string on_line = " on line " + std::to_string(line);
+    switch (error) {
+        case BindError::None: return "No error";
+        case BindError::InvalidLine: return "Invalid pyson value encountered" + on_line;
+        case BindError::InvalidValue: return "Invalid value for field " + name + on_line;
+        case BindError::WrongType:
+            return "Field " + name + on_line + " has type " + type_name(found) + ", expected " + type_name(expected);
+        case BindError::UnknownName: return "Unknown name " + name + on_line;
+        case BindError::DuplicateName: return "Field " + name + " set again" + on_line;
+        case BindError::MissingField: return "Missing field " + name;
+    }
+    return "Unknown BindError";
+}
+
+}
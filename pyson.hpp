@@ -10,17 +10,43 @@
 #define POSIX_FUNCTIONS_AVAILABLE 0
 #endif
 
+// Whether FileReader collects ReaderStats (see FileReader::stats()), off unless defined to 1.
+// It changes the layout of FileReader, so pyson.cpp has to be compiled with the same setting.
+#ifndef PYSON_STATS
+#define PYSON_STATS 0
+#endif
+
 #include <string>
+#include <string_view>
 #include <vector>
 #include <iosfwd>
 #include <optional>
 #include <cstring>
 #include <stdexcept>
 #include <unordered_map>
+#include <unordered_set>
 #include <functional>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <array>
+#include <type_traits>
+#include <memory>
+#include <memory_resource>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <ranges>
+#include <utility>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 #if POSIX_FUNCTIONS_AVAILABLE
 #include <stdio.h>
+#include <stdlib.h>
 #else
 #include <fstream>
 #endif
@@ -29,7 +55,21 @@ namespace pyson {
 
 class Value;
 class NamedValue;
+class NamedValueView;
+class LazyValue;
+class LazyNamedValue;
+class ValueView;
+class Document;
+class ColumnarTable;
+class FrozenMap;
+struct SpareStorage;
 class FileReader;
+class FileWriter;
+class MappedFileReader;
+class BinaryReader;
+class FollowReader;
+class LiveConfig;
+class SharedFileReader;
 
 /**
  * An enum that says which type a Value is.
@@ -68,6 +108,8 @@ union ValueInner {
     friend class Value;
         friend std::ostream& operator<< (std::ostream& o, const Value& val);
     friend class NamedValue;
+    friend class FileWriter;
+    friend bool parse_line(const char *line, size_t length, size_t first_colon, size_t second_colon, NamedValue& out, SpareStorage& spare);
 
 private:
     int m_int;
@@ -80,9 +122,9 @@ private:
     ValueInner(int val) noexcept : m_int(val) {}
     ValueInner(double val) noexcept : m_float(val) {}
     ValueInner(const std::string& str) noexcept : m_str(str) {}
-    ValueInner(std::string&& str) noexcept : m_str(str) {}
+    ValueInner(std::string&& str) noexcept : m_str(std::move(str)) {}
     ValueInner(const std::vector<std::string>& list) noexcept : m_list(list) {}
-    ValueInner(std::vector<std::string>&& list) noexcept : m_list(list) {}
+    ValueInner(std::vector<std::string>&& list) noexcept : m_list(std::move(list)) {}
 
     ~ValueInner() noexcept {}
 };
@@ -102,8 +144,10 @@ class Value {
 
 public:
     friend class FileReader;
+    friend class FileWriter;
     friend class NamedValue;
         friend bool operator>> (std::istream& i, NamedValue& v);
+    friend bool parse_line(const char *line, size_t length, size_t first_colon, size_t second_colon, NamedValue& out, SpareStorage& spare);
     friend std::ostream& operator<< (std::ostream& o, const Value& val);
 
     bool operator== (const Value& other) const noexcept;
@@ -124,18 +168,28 @@ public:
     /// Returns whether the Value is a list of strings
     bool is_list() const noexcept { return this->type() == PysonType::PysonList; }
 
-    // Returns the Value's value as a string
+    /// Returns the Value's value as a string in the pyson format, floats in their shortest form that reads back exactly
     string value_as_string() const noexcept;
+    /// Number of chars value_as_string() returns, without making the string
+    size_t serialized_size() const noexcept;
+    /// Append the Value's value to a string, the same chars value_as_string() returns
+    void serialize_to(string& out) const;
+    /**
+     * Write the Value's value to a buffer with room for at least serialized_size() chars,
+     * the same chars value_as_string() returns, without a null terminator.
+     * Returns a pointer to just after the last char written.
+     */
+    char *serialize_to(char *out) const noexcept;
 
     /// Construct a Value from another Value
     Value(const Value&);
-    Value(Value&&);
+    Value(Value&&) noexcept;
     /// Assign a Value to the value of another Value
     Value& operator= (const Value&);
-    Value& operator= (Value&&);
+    Value& operator= (Value&&) noexcept;
 
     /// Construct a Value from a string formatted as a pyson list
-    static Value from_pyson_list(string pyson_list);
+    static Value from_pyson_list(std::string_view pyson_list);
 
     /// Construct a Value from an integer
     explicit Value(int val) : m_type(PysonType::PysonInt), m_value(val) {}
@@ -143,10 +197,10 @@ public:
     explicit Value(double val) : m_type(PysonType::PysonFloat), m_value(val) {}
     /// Construct a Value from a string
     explicit Value(const string& str) : m_type(PysonType::PysonStr), m_value(str) {}
-    explicit Value(string&& str) : m_type(PysonType::PysonStr), m_value(str) {}
+    explicit Value(string&& str) : m_type(PysonType::PysonStr), m_value(std::move(str)) {}
     /// Construct a Value from a list of strings
     explicit Value(const vector<string>& list) : m_type(PysonType::PysonList), m_value(list) {}
-    explicit Value(vector<string>&& list) : m_type(PysonType::PysonList), m_value(list) {}
+    explicit Value(vector<string>&& list) : m_type(PysonType::PysonList), m_value(std::move(list)) {}
 
     /// Destruct a Value, including correctly destructing the ValueInner
     ~Value() noexcept;
@@ -178,23 +232,35 @@ public:
      * All strings that don't contain newlines are valid in pyson,
      * so the default may be returned if it was the actual value
      */
-    string string_or(string default_val) const noexcept {
+    string string_or(string default_val) const& noexcept {
         switch (type()) {
             case PysonType::PysonStr: return m_value.m_str;
             default: return default_val;
         }
     }
+    string string_or(string default_val) && noexcept {
+        switch (type()) {
+            case PysonType::PysonStr: return std::move(m_value.m_str);
+            default: return default_val;
+        }
+    }
     /**
      * Get the list from the Value, or a custom default value.
      * All strings without newlines are valid in pyson,
      * so the default may be returned if it was the actual value.
      */
-    vector<string> list_or(vector<string> default_val) const noexcept {
+    vector<string> list_or(vector<string> default_val) const& noexcept {
         switch(type()) {
             case PysonType::PysonList: return m_value.m_list;
             default: return default_val;
         }
     }
+    vector<string> list_or(vector<string> default_val) && noexcept {
+        switch(type()) {
+            case PysonType::PysonList: return std::move(m_value.m_list);
+            default: return default_val;
+        }
+    }
 
     /**
      * Get the int from the Value, or 0 if it was not an int
@@ -213,13 +279,15 @@ public:
      * Note: if this returns an empty string that does not necessarily mean it was not a string,
      * empty strings are valid in pyson
      */
-    string string_or_empty() const noexcept { return string_or(""); }
+    string string_or_empty() const& noexcept { return string_or(""); }
+    string string_or_empty() && noexcept { return std::move(*this).string_or(""); }
     /**
      * Get the list of strings from the Value, or an empty list if the value was not a list.
      * Note: if this returns and empty list that does not necessarily mean it was not a list,
      * empty lists are valid in pyson.
      */
-    vector<string> list_or_empty() const noexcept { return list_or(vector<string>{}); }
+    vector<string> list_or_empty() const& noexcept { return list_or(vector<string>{}); }
+    vector<string> list_or_empty() && noexcept { return std::move(*this).list_or(vector<string>{}); }
 
     /// Get the integer from the Value, or a null option if the value isn't an integer
     optional<int> get_int() const noexcept {
@@ -236,19 +304,31 @@ public:
         }
     }
     /// Get the string from the Value, or a null option if the value isn't a string
-    optional<string> get_string() const noexcept {
+    optional<string> get_string() const& noexcept {
         switch(type()) {
             case PysonType::PysonStr: return m_value.m_str;
             default: return std::nullopt;
         }
     }
+    optional<string> get_string() && noexcept {
+        switch(type()) {
+            case PysonType::PysonStr: return std::move(m_value.m_str);
+            default: return std::nullopt;
+        }
+    }
     /// Get the list from the Value, or a null option if the value isn't a list
-    optional<vector<string>> get_list() const noexcept {
+    optional<vector<string>> get_list() const& noexcept {
         switch(type()) {
             case PysonType::PysonList: return m_value.m_list;
             default: return std::nullopt;
         }
     }
+    optional<vector<string>> get_list() && noexcept {
+        switch(type()) {
+            case PysonType::PysonList: return std::move(m_value.m_list);
+            default: return std::nullopt;
+        }
+    }
 
     /// Get the int from the Value, or throw a WrongPysonType if it isn't an int
     int int_or_throw() const {
@@ -269,16 +349,43 @@ public:
         }
     }
     /// Get the string from the Value, or throw a WrongPysonType if it isn't a string
-    string string_or_throw() const {
+    string string_or_throw() const& { return string_ref_or_throw(); }
+    string string_or_throw() && {
         PysonType found_type = type();
         constexpr PysonType expected_type = PysonType::PysonStr;
         switch (found_type) {
-            case expected_type: return m_value.m_str;
+            case expected_type: return std::move(m_value.m_str);
             default: throw WrongPysonType(expected_type, found_type);
         }
     }
     /// Get the list from the Value, or throw a WrongPysonType if it isn't a list
-    vector<string> list_or_throw() const {
+    vector<string> list_or_throw() const& { return list_ref_or_throw(); }
+    vector<string> list_or_throw() && {
+        PysonType found_type = type();
+        constexpr PysonType expected_type = PysonType::PysonList;
+        switch (found_type) {
+            case expected_type: return std::move(m_value.m_list);
+            default: throw WrongPysonType(expected_type, found_type);
+        }
+    }
+
+    /**
+     * Accessors that don't copy anything.
+     * The references, views, and spans they return point into the Value,
+     * so they are only valid while the Value is alive and isn't changed.
+     */
+
+    /// Get a reference to the string, or throw a WrongPysonType if it isn't a string
+    const string& string_ref_or_throw() const& {
+        PysonType found_type = type();
+        constexpr PysonType expected_type = PysonType::PysonStr;
+        switch (found_type) {
+            case expected_type: return m_value.m_str;
+            default: throw WrongPysonType(expected_type, found_type);
+        }
+    }
+    /// Get a reference to the list, or throw a WrongPysonType if it isn't a list
+    const vector<string>& list_ref_or_throw() const& {
         PysonType found_type = type();
         constexpr PysonType expected_type = PysonType::PysonList;
         switch (found_type) {
@@ -286,6 +393,34 @@ public:
             default: throw WrongPysonType(expected_type, found_type);
         }
     }
+    /// Get a view of the string, or a default view if it isn't a string
+    std::string_view string_view_or(std::string_view default_val) const& noexcept {
+        switch (type()) {
+            case PysonType::PysonStr: return m_value.m_str;
+            default: return default_val;
+        }
+    }
+    /// Get a view of the string, or a null option if it isn't a string
+    optional<std::string_view> get_string_view() const& noexcept {
+        switch (type()) {
+            case PysonType::PysonStr: return std::string_view(m_value.m_str);
+            default: return std::nullopt;
+        }
+    }
+    /// Get a span over the list, or a default span (empty unless given) if it isn't a list
+    std::span<const string> list_span_or(std::span<const string> default_val = {}) const& noexcept {
+        switch (type()) {
+            case PysonType::PysonList: return m_value.m_list;
+            default: return default_val;
+        }
+    }
+    /// Get a span over the list, or a null option if it isn't a list
+    optional<std::span<const string>> get_list_span() const& noexcept {
+        switch (type()) {
+            case PysonType::PysonList: return std::span<const string>(m_value.m_list);
+            default: return std::nullopt;
+        }
+    }
 
     /**
      * Make the value become a string, no matter what it was previously.
@@ -309,140 +444,1050 @@ class NamedValue {
 
 public:
     friend class FileReader;
+    friend class FileWriter;
     /// Print a NamedValue in the pyson format
-    friend std::ostream& operator<< (std::ostream& o, NamedValue& v);
+    friend std::ostream& operator<< (std::ostream& o, const NamedValue& v);
     /// Read in a NamedValue using the pyson format
     friend bool operator>> (std::istream& i, NamedValue& v);
+    friend bool parse_line(const char *line, size_t length, size_t first_colon, size_t second_colon, NamedValue& out, SpareStorage& spare);
 
     /// Construct a NamedValue from a name and a Value
     explicit NamedValue(const std::string& name, const Value& value) : m_name(name), m_value(value) {}
-    explicit NamedValue(const std::string& name, Value&& value) : m_name(name), m_value(value) {}
-    explicit NamedValue(std::string&& name, const Value& value) : m_name(name), m_value(value) {}
-    explicit NamedValue(std::string&& name, Value&& value) : m_name(name), m_value(value) {}
+    explicit NamedValue(const std::string& name, Value&& value) : m_name(name), m_value(std::move(value)) {}
+    explicit NamedValue(std::string&& name, const Value& value) : m_name(std::move(name)), m_value(value) {}
+    explicit NamedValue(std::string&& name, Value&& value) : m_name(std::move(name)), m_value(std::move(value)) {}
 
     /// Returns the name of the NamedValue
-    std::string name() const noexcept { return m_name; }
+    std::string name() const& noexcept { return m_name; }
+    std::string name() && noexcept { return std::move(m_name); }
     /// Returns the Value contained by the NamedValue
-    Value value() const noexcept { return m_value; }
+    Value value() const& noexcept { return m_value; }
+    Value value() && noexcept { return std::move(m_value); }
+    /// Returns a reference to the name, valid while the NamedValue is alive and isn't changed
+    const std::string& name_ref() const& noexcept { return m_name; }
+    /// Returns a view of the name, valid while the NamedValue is alive and isn't changed
+    std::string_view name_view() const& noexcept { return m_name; }
+    /// Returns a reference to the Value, valid while the NamedValue is alive and isn't changed
+    const Value& value_ref() const& noexcept { return m_value; }
+
+    /// Append the NamedValue to a string as a pyson line (name:type:value), without the newline
+    void serialize_to(std::string& out) const;
 
     /// Change the name of a NamedValue
     void change_name(const std::string& new_name) noexcept { m_name = new_name; }
+    void change_name(std::string&& new_name) noexcept { m_name = std::move(new_name); }
     /// Swap out the value of a NamedValue, keeping the name
     void change_value(const Value& new_value) noexcept { m_value = new_value; }
+    void change_value(Value&& new_value) noexcept { m_value = std::move(new_value); }
 };
 
-class FileReader {
+// so growing a std::vector of them moves the strings and lists instead of copying them
+static_assert(std::is_nothrow_move_constructible_v<Value> && std::is_nothrow_move_assignable_v<Value>,
+    "pyson::Value has to be nothrow movable");
+static_assert(std::is_nothrow_move_constructible_v<NamedValue> && std::is_nothrow_move_assignable_v<NamedValue>,
+    "pyson::NamedValue has to be nothrow movable");
 
-#if POSIX_FUNCTIONS_AVAILABLE
-    FILE *m_handle;
-#else
-    std::ifstream m_stream;
-#endif
+/**
+ * A Value that doesn't own its string or list.
+ * It has the same accessors as Value, but strings come out as std::string_view
+ * and lists as a std::span of std::string_view, pointing into memory owned by
+ * something else (like a Document), so a ValueView must not outlive whatever it came from.
+ */
+class ValueView {
+    using list_type = std::span<const std::string_view>;
+
+    PysonType m_type;
+    union {
+        int m_int;
+        double m_float;
+        std::string_view m_str;
+        list_type m_list;
+    };
 
 public:
-    FileReader(const char *path);
-    FileReader(const std::string& path);
+    /// Views of ints and floats don't point to anything, so they can be made from just the number
+    explicit ValueView(int val) noexcept : m_type(PysonType::PysonInt), m_int(val) {}
+    explicit ValueView(double val) noexcept : m_type(PysonType::PysonFloat), m_float(val) {}
+    /// Make a view of a string
+    explicit ValueView(std::string_view str) noexcept : m_type(PysonType::PysonStr), m_str(str) {}
+    /// Make a view of a list, the elements have to stay where they are while the view is used
+    explicit ValueView(list_type list) noexcept : m_type(PysonType::PysonList), m_list(list) {}
+
+    /// Get the type of the value as a PysonType
+    PysonType type() const noexcept { return m_type; }
+    /// Get the type of the value as a C string (const char *)
+    const char *type_cstring() const noexcept;
+
+    /// Returns whether the value is an integer
+    bool is_int() const noexcept { return this->type() == PysonType::PysonInt; }
+    /// Returns whether the value is a floating-point number
+    bool is_float() const noexcept { return this->type() == PysonType::PysonFloat; }
+    /// Returns whether the value is a string
+    bool is_str() const noexcept { return this->type() == PysonType::PysonStr; }
+    /// Returns whether the value is a list of strings
+    bool is_list() const noexcept { return this->type() == PysonType::PysonList; }
+
+    /// Get the int, or a default value if it isn't an int
+    int int_or(int default_val) const noexcept { return is_int() ? m_int : default_val; }
+    /// Get the 64-bit float, or a default value if it isn't a float
+    double float_or(double default_val) const noexcept { return is_float() ? m_float : default_val; }
+    /// Get the string, or a default value if it isn't a string
+    std::string_view string_or(std::string_view default_val) const noexcept { return is_str() ? m_str : default_val; }
+    /// Get the list, or a default value if it isn't a list
+    list_type list_or(list_type default_val) const noexcept { return is_list() ? m_list : default_val; }
+
+    /// Get the int, or a null option if the value isn't an int
+    std::optional<int> get_int() const noexcept {
+        if (is_int()) return m_int;
+        else return std::nullopt;
+    }
+    /// Get the 64-bit float, or a null option if the value isn't a float
+    std::optional<double> get_float() const noexcept {
+        if (is_float()) return m_float;
+        else return std::nullopt;
+    }
+    /// Get the string, or a null option if the value isn't a string
+    std::optional<std::string_view> get_string() const noexcept {
+        if (is_str()) return m_str;
+        else return std::nullopt;
+    }
+    /// Get the list, or a null option if the value isn't a list
+    std::optional<list_type> get_list() const noexcept {
+        if (is_list()) return m_list;
+        else return std::nullopt;
+    }
+
+    /// Get the int, or throw a WrongPysonType if it isn't an int
+    int int_or_throw() const {
+        if (!is_int()) throw WrongPysonType(PysonType::PysonInt, type());
+        return m_int;
+    }
+    /// Get the 64-bit float, or throw a WrongPysonType if it isn't a float
+    double float_or_throw() const {
+        if (!is_float()) throw WrongPysonType(PysonType::PysonFloat, type());
+        return m_float;
+    }
+    /// Get the string, or throw a WrongPysonType if it isn't a string
+    std::string_view string_or_throw() const {
+        if (!is_str()) throw WrongPysonType(PysonType::PysonStr, type());
+        return m_str;
+    }
+    /// Get the list, or throw a WrongPysonType if it isn't a list
+    list_type list_or_throw() const {
+        if (!is_list()) throw WrongPysonType(PysonType::PysonList, type());
+        return m_list;
+    }
+
+    /// Copy the value into an owning Value
+    Value to_value() const;
+};
+
+/**
+ * Parse a single pyson line into a NamedValue.
+ * The line should not include the trailing newline.
+ * This is what FileReader and operator>> use under the hood: it scans the line once,
+ * and converts numbers with std::from_chars, so it doesn't depend on the locale.
+ * Returns false (leaving the NamedValue in an unspecified but valid state)
+ * if the line isn't valid pyson.
+ */
+bool parse_line(const char *line, size_t length, NamedValue& out);
+/// Same as parse_line() above, but for when the positions of both colons are already known
+/// (relative to the start of the line), for example from a StructuralIndex.
+bool parse_line(const char *line, size_t length, size_t first_colon, size_t second_colon, NamedValue& out);
+
+/**
+ * Somewhere for parse_line() to keep the string or list storage of a NamedValue
+ * whose type changes, so it can be given back when the type changes back.
+ * FileReader keeps one of these, so reading lines of different types into the same
+ * NamedValue with next_into() doesn't have to allocate new storage every time.
+ */
+struct SpareStorage {
+    std::string str;
+    std::vector<std::string> list;
+};
+/// Same as the parse_line() above, but borrows and returns storage from `spare`
+bool parse_line(const char *line, size_t length, size_t first_colon, size_t second_colon, NamedValue& out, SpareStorage& spare);
+
+/**
+ * The positions of the structural characters (newlines and the two colons of each line)
+ * in a buffer of pyson text, found in one pass over the whole buffer.
+ * Building one uses SSE2 or AVX2 when the CPU has them, and plain loops otherwise.
+ * Colons after the second one on a line are part of the value, so they aren't recorded.
+ */
+struct StructuralIndex {
+    /// Returned for a colon that the line doesn't have
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    /// Offset of the first byte of each line
+    std::vector<size_t> line_starts;
+    /// Offset of the first colon of each line, or npos
+    std::vector<size_t> first_colons;
+    /// Offset of the second colon of each line, or npos
+    std::vector<size_t> second_colons;
+    /// Offset one past the last byte of each line, not counting the newline
+    std::vector<size_t> line_ends;
+
+    /// Number of lines in the buffer (a trailing newline doesn't start another line)
+    size_t line_count() const noexcept { return line_starts.size(); }
+
+    /// Index the buffer `data` of `size` bytes
+    static StructuralIndex build(const char *data, size_t size);
+    /// Name of the scanning kernel build() uses on this CPU ("avx2", "sse2", or "scalar")
+    static const char *kernel_name() noexcept;
+};
+
+/**
+ * A NamedValue that doesn't own anything.
+ * The name, type and raw payload are string_views into memory owned by something else
+ * (usually a MappedFileReader), so a NamedValueView must not outlive whatever it came from.
+ * Nothing gets converted or copied until you call to_value() or to_named_value().
+ */
+class NamedValueView {
+    std::string_view m_name;
+    std::string_view m_type_tag;
+    std::string_view m_payload;
+    PysonType m_type;
+
+public:
+    friend class MappedFileReader;
+
+    /// Construct an empty view (an int named "" with an empty payload)
+    NamedValueView() noexcept : m_name(), m_type_tag(), m_payload(), m_type(PysonType::PysonInt) {}
 
-    /** 
-     * Get the next NamedValue from the file,
-     * or the null option if either the file ended.
-     * Throws an exception if the NamedValue is invalid.
-     */
-    std::optional<NamedValue> next();
     /**
-     * Get the next NamedValue from the file,
-     * or a predetermined default NamedValue if the file ended.
-     * Throws an exception if the NamedValue is invalid.
+     * Split a single pyson line (without the trailing newline) into a view.
+     * Returns false if the line isn't formatted like name:type:value
+     * or the type isn't one of int, float, str, or list.
+     * The payload isn't checked, so an int line with a non-number payload will still return true.
      */
-    NamedValue next_or(const NamedValue& default_value);
-    NamedValue next_or(NamedValue&& default_value);
-    /// Get the next NamedValue from the file,
-    /// or throw an exception if the file ended or the NamedValue is invalid
-    NamedValue next_or_throw();
+    static bool from_line(std::string_view line, NamedValueView& out) noexcept;
+
+    /// Returns the name of the value
+    std::string_view name() const noexcept { return m_name; }
+    /// Returns the type of the value as a PysonType
+    PysonType type() const noexcept { return m_type; }
+    /// Returns the type of the value exactly as written in the file ("int", "float", "str", or "list")
+    std::string_view type_tag() const noexcept { return m_type_tag; }
+    /// Returns everything after the second colon, unconverted
+    std::string_view raw_value() const noexcept { return m_payload; }
+
+    /// Convert the payload into an owning Value.
+    /// Throws an exception if the payload isn't valid for the type.
+    Value to_value() const;
+    /// Convert the view into an owning NamedValue.
+    /// Throws an exception if the payload isn't valid for the type.
+    NamedValue to_named_value() const;
 
     /**
-     * Get a vector that contains each NamedValue from the file.
-     * This call will read the entire file,
-     * not just the portion after the current read position.
+     * Convert the payload straight into an existing variable, without making a Value.
+     * Strings and lists reuse the memory the variable already has.
+     * Returns false, leaving the variable as it was, if the value isn't of that type
+     * or the payload isn't valid for it.
      */
-    std::vector<NamedValue> all();
+    bool decode_into(int& out) const noexcept;
+    bool decode_into(double& out) const noexcept;
+    bool decode_into(std::string& out) const;
+    bool decode_into(std::vector<std::string>& out) const;
+};
+
+/**
+ * A Value whose payload is only converted the first time it's needed.
+ * FileReader's lazy reads (next_lazy(), all_lazy()) check the name and type of each line,
+ * but keep the payload as text. Numbers are converted and lists are split the first time an
+ * accessor needs them, and the result is cached, so values that are never looked at cost nothing.
+ * Because of that, a payload that isn't valid for its type is only noticed when the value is
+ * looked at: then the accessors throw a std::runtime_error.
+ * The cache is filled in by const accessors, so don't share an undecoded LazyValue between
+ * threads without calling decode() first.
+ */
+class LazyValue {
+    PysonType m_type;
+    std::string m_payload;
+    mutable std::optional<Value> m_decoded;
+
+    friend class FileReader;
+    friend class LazyNamedValue;
+
+public:
+    /// Construct a LazyValue from a type and the payload text that should be converted to it
+    explicit LazyValue(PysonType type, std::string payload) : m_type(type), m_payload(std::move(payload)), m_decoded() {}
+    /// Construct an already decoded LazyValue
+    explicit LazyValue(Value value) : m_type(value.type()), m_payload(), m_decoded(std::move(value)) {}
+
+    /// Returns the type of the value as a PysonType (this never decodes anything)
+    PysonType type() const noexcept { return m_type; }
+    bool is_int() const noexcept { return m_type == PysonType::PysonInt; }
+    bool is_float() const noexcept { return m_type == PysonType::PysonFloat; }
+    bool is_str() const noexcept { return m_type == PysonType::PysonStr; }
+    bool is_list() const noexcept { return m_type == PysonType::PysonList; }
+    /// Whether the payload has been converted yet
+    bool is_decoded() const noexcept { return m_decoded.has_value(); }
+    /// The payload exactly as it was in the file (empty if the LazyValue was made from a Value)
+    std::string_view raw_value() const noexcept { return m_payload; }
+
+    /// Convert the payload if that hasn't happened yet, and get the Value.
+    /// Throws a std::runtime_error if the payload isn't valid for the type.
+    const Value& decode() const;
+    /// Same as decode(), but copies the Value out
+    Value to_value() const { return decode(); }
 
     /**
-     * Get a hashmap of each name to its Value from the file.
-     * This call will read the entire file,
-     * not just the portion after the current read position.
+     * Same as the Value accessors. Asking for the wrong type never decodes anything,
+     * asking for the right one decodes first (and so can throw a std::runtime_error).
+     * Strings are read straight from the payload, they don't need decoding.
      */
-    std::unordered_map<std::string, Value> as_hashmap();
+    std::optional<int> get_int() const { return is_int() ? decode().get_int() : std::nullopt; }
+    std::optional<double> get_float() const { return is_float() ? decode().get_float() : std::nullopt; }
+    std::optional<std::string> get_string() const {
+        if (!is_str()) return std::nullopt;
+        return std::string(string_view_or({}));
+    }
+    std::optional<std::vector<std::string>> get_list() const { return is_list() ? decode().get_list() : std::nullopt; }
+    int int_or(int default_val) const { return is_int() ? decode().int_or(default_val) : default_val; }
+    double float_or(double default_val) const { return is_float() ? decode().float_or(default_val) : default_val; }
+    std::string string_or(std::string default_val) const {
+        return is_str() ? std::string(string_view_or({})) : default_val;
+    }
+    std::vector<std::string> list_or(std::vector<std::string> default_val) const {
+        return is_list() ? decode().list_or(default_val) : default_val;
+    }
+    int int_or_throw() const {
+        if (!is_int()) throw WrongPysonType(PysonType::PysonInt, type());
+        return decode().int_or_throw();
+    }
+    double float_or_throw() const {
+        if (!is_float()) throw WrongPysonType(PysonType::PysonFloat, type());
+        return decode().float_or_throw();
+    }
+    std::string string_or_throw() const {
+        if (!is_str()) throw WrongPysonType(PysonType::PysonStr, type());
+        return std::string(string_view_or({}));
+    }
+    const std::vector<std::string>& list_ref_or_throw() const {
+        if (!is_list()) throw WrongPysonType(PysonType::PysonList, type());
+        return decode().list_ref_or_throw();
+    }
+    /// A view of the string, or a default view if it isn't a string
+    std::string_view string_view_or(std::string_view default_val) const noexcept {
+        if (!is_str()) return default_val;
+        return m_decoded.has_value() ? m_decoded->string_view_or(default_val) : std::string_view(m_payload);
+    }
+    /// A span over the decoded list, or a default span (empty unless given) if it isn't a list
+    std::span<const std::string> list_span_or(std::span<const std::string> default_val = {}) const {
+        return is_list() ? decode().list_span_or(default_val) : default_val;
+    }
+};
 
-    /// Reset read progress to the beginning of the file
-    void go_to_beginning();
+/// A LazyValue, but with a name
+class LazyNamedValue {
+    std::string m_name;
+    LazyValue m_value;
 
-    /// Go to a specific line in the file, start reading from that line
-    /// Throws an exception if EOF is encountered before that line
-    void go_to_line(size_t line_number);
+    friend class FileReader;
 
-    /// Skip the next N lines
-    void skip_n_lines(size_t amount_to_skip);
+public:
+    /// Construct a LazyNamedValue from a name and a LazyValue
+    explicit LazyNamedValue(std::string name, LazyValue value) : m_name(std::move(name)), m_value(std::move(value)) {}
 
     /**
-     * Locate the Value with a specific name from the file.
-     * The value will be found if it exists anywhere in the file,
-     * even before the current read location.
-     * The next Value read by next() will be the one after the value found.
+     * Split a single pyson line (without the trailing newline) into out, reusing its storage.
+     * Returns false if the line isn't formatted like name:type:value
+     * or the type isn't one of int, float, str, or list.
+     * The payload isn't converted or checked until the value is looked at.
      */
-    std::optional<Value> value_with_name(const char *name);
-    std::optional<Value> value_with_name(const std::string& name) { return value_with_name(name.c_str()); }
+    static bool from_line(std::string_view line, LazyNamedValue& out);
+
+    /// Returns the name
+    const std::string& name() const noexcept { return m_name; }
+    /// Returns the value, which decodes itself when it's looked at
+    const LazyValue& value() const noexcept { return m_value; }
+    /// Decode the value and copy everything into a NamedValue.
+    /// Throws a std::runtime_error if the payload isn't valid for the type.
+    NamedValue to_named_value() const { return NamedValue(m_name, m_value.decode()); }
+};
+
+/**
+ * Every NamedValue from a pyson file, stored in one arena.
+ * The text of the file, the list elements, and the table of records are all allocated
+ * from a single std::pmr::memory_resource, which by default is a monotonic arena owned by
+ * the Document, so destroying a Document frees everything at once, without walking it.
+ * Names come out as std::string_view and values as ValueView, both pointing into the Document.
+ */
+class Document {
+    struct Record {
+        Record() noexcept : name(), type(PysonType::PysonInt), m_int(0) {}
+
+        std::string_view name;
+        PysonType type;
+        union {
+            int m_int;
+            double m_float;
+            std::string_view m_str;
+            /// Where the list's elements are in m_list_elements
+            struct { size_t first; size_t count; } m_list;
+        };
+    };
 
     /**
-     * Execute a function for each NamedValue left in the file.
-     * This function will not rewind to the beginning of the file.
+     * Everything the views point into. It lives behind a pointer so moving a Document
+     * never moves the text (a short string would move out of its small-string buffer),
+     * and the containers never change arenas.
      */
-    void for_each(std::function<void(NamedValue)> predicate);
+    struct Storage {
+        explicit Storage(std::pmr::memory_resource *resource);
+
+        /// Destroyed last, after everything allocated from it
+        std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+        std::pmr::memory_resource *resource;
+        std::pmr::string text;
+        std::pmr::vector<Record> records;
+        std::pmr::vector<std::string_view> list_elements;
+    };
+
+    /// Only null after the Document has been moved from
+    std::unique_ptr<Storage> m_storage;
+
+    explicit Document(std::pmr::memory_resource *resource);
+    friend class FileReader;
+
+    /// Parse all of the text into the records, throwing invalid_message if a line isn't valid
+    void parse_text(const char *invalid_message);
+
+public:
+    /// Views from the moved-from Document stay valid, they now belong to the new one.
+    /// A moved-from Document is empty.
+    Document(Document&&) noexcept = default;
+    Document& operator= (Document&&) noexcept = default;
+
+    /// Number of NamedValues in the document
+    size_t size() const noexcept { return m_storage ? m_storage->records.size() : 0; }
+    /// The name of the NamedValue at index i
+    std::string_view name(size_t i) const;
+    /// The value of the NamedValue at index i
+    ValueView value(size_t i) const;
+    /// The NamedValue at index i, copied into an owning NamedValue
+    NamedValue named_value(size_t i) const;
+
+    /// Get the value of the first NamedValue with a name, or a null option if there isn't one
+    std::optional<ValueView> value_with_name(std::string_view name) const;
+
+    /// The memory resource everything in the document is allocated from (nullptr once moved from)
+    std::pmr::memory_resource *resource() const noexcept { return m_storage ? m_storage->resource : nullptr; }
+};
+
+/**
+ * A whole pyson file stored column by column (struct of arrays) instead of as NamedValues.
+ * Each type has its own contiguous column: the ints, the floats, the strings,
+ * and the lists (as ranges of one array of list elements). Next to those are one byte per record
+ * for its type, and the index of each record in the column of its type.
+ * Names, strings and list elements are views into blobs owned by the table.
+ * Passes over one type, like summing every int or finding the smallest float,
+ * only touch that type's column, and the loops over them can be vectorized.
+ * Views from a ColumnarTable are valid for as long as the table is alive. Moving a table keeps them valid
+ * (the blobs move with it), but a table can't be copied: the copy's views would point into the original.
+ */
+class ColumnarTable {
+    std::vector<PysonType> m_types;
+    /// Index of each record in the column of its type
+    std::vector<uint32_t> m_column_index;
+    /// Record i's name is m_names[m_name_offsets[i] .. m_name_offsets[i + 1]]
+    std::vector<char> m_names;
+    std::vector<size_t> m_name_offsets;
+    std::vector<int> m_ints;
+    std::vector<double> m_floats;
+    /// Strings and list elements, a vector because moving a std::string can move its contents
+    std::vector<char> m_payload;
+    std::vector<std::string_view> m_strings;
+    /// List k is m_list_elements[m_list_offsets[k] .. m_list_offsets[k + 1]]
+    std::vector<size_t> m_list_offsets;
+    std::vector<std::string_view> m_list_elements;
+
+public:
+    /// Copy every record of a Document into columns
+    explicit ColumnarTable(const Document& document);
+
+    ColumnarTable(const ColumnarTable&) = delete;
+    ColumnarTable& operator= (const ColumnarTable&) = delete;
+    ColumnarTable(ColumnarTable&&) noexcept = default;
+    ColumnarTable& operator= (ColumnarTable&&) noexcept = default;
+
+    /// Number of NamedValues in the table
+    size_t size() const noexcept { return m_types.size(); }
+    /// The type of the NamedValue at index i
+    PysonType type(size_t i) const { return m_types.at(i); }
+    /// The name of the NamedValue at index i
+    std::string_view name(size_t i) const;
+    /// The value of the NamedValue at index i
+    ValueView value(size_t i) const;
+    /// The NamedValue at index i, copied into an owning NamedValue
+    NamedValue named_value(size_t i) const;
+    /// Get the value of the first NamedValue with a name, or a null option if there isn't one
+    std::optional<ValueView> value_with_name(std::string_view name) const;
 
     /**
-     * Map each NamedValue, and then get all of the results.
-     * This function will not rewind to the beginning of the file.
+     * Where the NamedValue at index i is in the column of its type,
+     * for example ints()[column_index(i)] if it's an int, or list(column_index(i)) if it's a list.
      */
-    template <class Return>
-    std::vector<Return> map_each(std::function<Return(NamedValue)> predicate);
+    size_t column_index(size_t i) const { return m_column_index.at(i); }
+    /// The type of every NamedValue, in file order
+    std::span<const PysonType> types() const noexcept { return m_types; }
+    /// Every int in the file, in file order
+    std::span<const int> ints() const noexcept { return m_ints; }
+    /// Every float in the file, in file order
+    std::span<const double> floats() const noexcept { return m_floats; }
+    /// Every string in the file, in file order
+    std::span<const std::string_view> strings() const noexcept { return m_strings; }
+    /// Number of lists in the file
+    size_t list_count() const noexcept { return m_list_offsets.size() - 1; }
+    /// The elements of list k (the k-th list in the file)
+    std::span<const std::string_view> list(size_t k) const;
+    /// The elements of every list in the file, one list after another
+    std::span<const std::string_view> list_elements() const noexcept { return m_list_elements; }
+    /// Number of NamedValues of a type, without looking at the types column
+    size_t count(PysonType type) const noexcept;
+};
+
+/**
+ * An immutable name -> Value map, built once (usually with FileReader::as_frozen_map()).
+ * Unlike the std::unordered_map from as_hashmap(), there are no nodes: the values are stored
+ * contiguously in file order, the names are packed into one string, and the lookup table is
+ * a flat array of (hash, index) slots with linear probing, at most half full.
+ * Lookups take a std::string_view, so a const char * or a std::string_view
+ * never has to be copied into a std::string first.
+ */
+class FrozenMap {
+    struct Slot {
+        /// 0 for an empty slot
+        uint64_t hash;
+        size_t index;
+    };
+
+    std::vector<Value> m_values;
+    /// Value i's name is m_names[m_name_offsets[i] .. m_name_offsets[i + 1]]
+    std::string m_names;
+    std::vector<size_t> m_name_offsets;
+    std::vector<Slot> m_slots;
 
+public:
+    /// An empty map
+    FrozenMap() noexcept : m_values(), m_names(), m_name_offsets{0}, m_slots() {}
     /**
-     * Call a function for each NamedValue left in the file while the function returns true.
-     * This function will not rewind to the beginning of the file.
+     * Build a map from NamedValues, their values are moved into the map.
+     * Throws an exception if a name appears more than once.
      */
-    void for_each_while(std::function<bool(NamedValue)> predicate);
+    explicit FrozenMap(std::vector<NamedValue> values);
+
+    /// Number of values in the map
+    size_t size() const noexcept { return m_values.size(); }
+    /// Returns whether the map is empty
+    bool empty() const noexcept { return m_values.empty(); }
+
+    /// Get the value with a name, or nullptr if there isn't one
+    const Value *find(std::string_view name) const noexcept;
+    /// Returns whether there is a value with a name
+    bool contains(std::string_view name) const noexcept { return find(name) != nullptr; }
+    /// Get the value with a name, or throw a std::out_of_range if there isn't one
+    const Value& at(std::string_view name) const;
+
+    /// The name of the value at index i, in the order they were in the file
+    std::string_view name(size_t i) const;
+    /// The value at index i, in the order they were in the file
+    const Value& value(size_t i) const { return m_values.at(i); }
+    /// Every value, in the order they were in the file
+    std::span<const Value> values() const noexcept { return m_values; }
+};
+
+/// How FileReader::all(), FileReader::as_hashmap() and pyson::load_many() should split the work between threads
+struct ParallelOptions {
+    /// Number of threads to parse with, 0 means one per hardware thread
+    unsigned threads = 0;
+    /// Don't give a thread less than this many bytes of the file to parse
+    size_t min_chunk_size = 1 << 20;
+};
+
+/**
+ * A hash table from each name in a pyson file to where that name's line is,
+ * saved next to the file as a sidecar (the file's path with ".idx" added).
+ * The sidecar remembers the size and modification time of the file it was built from,
+ * and load() won't return an index that doesn't match the file anymore.
+ * Only hashes of the names are stored, so looking a name up gives the lines that could be it,
+ * and whoever reads the line has to check the name (FileReader::value_with_name() does this).
+ * If a name appears more than once, only the first one is in the index.
+ */
+class NameIndex {
+public:
+    /// Where a line is in the file
+    struct Location {
+        /// Byte offset of the start of the line
+        uint64_t offset;
+        /// Line number, starting at 0 like FileReader::go_to_line()
+        uint64_t line;
+    };
+
+private:
+    struct Slot {
+        uint64_t hash;
+        Location location;
+    };
+
+    std::vector<Slot> m_slots;
+    size_t m_size;
+
+    NameIndex() noexcept : m_slots(), m_size(0) {}
+
+public:
+    /// The path of the sidecar for a pyson file
+    static std::string sidecar_path(const std::string& pyson_path) { return pyson_path + ".idx"; }
 
     /**
-     * Map each NamedValue while the function returns true and some Return value.
-     * Note: the last Return value will not be included in the result.
-     * This function will not rewind to the beginning of the file.
+     * Build the index for a pyson file and write it to the sidecar.
+     * Throws an exception if either file can't be used, or a line of the file has no name.
      */
-    template <class Return>
-    std::vector<Return> map_while(std::function<std::pair<bool, Return>(NamedValue)> predicate);
+    static NameIndex build(const char *pyson_path);
+    static NameIndex build(const std::string& pyson_path) { return build(pyson_path.c_str()); }
+
+    /// Load the sidecar of a pyson file, or get the null option if
+    /// there isn't one or it was built from a different version of the file
+    static std::optional<NameIndex> load(const char *pyson_path);
+    static std::optional<NameIndex> load(const std::string& pyson_path) { return load(pyson_path.c_str()); }
+
+    /// Load the sidecar of a pyson file if it's still valid, otherwise build a new one
+    static NameIndex load_or_build(const char *pyson_path);
+    static NameIndex load_or_build(const std::string& pyson_path) { return load_or_build(pyson_path.c_str()); }
 
     /**
-     * Map each NamedValue while the function doesn't return std::nullopt.
-     * This function will not rewind to the beginning of the file.
+     * Call a function with each Location whose name hashes the same as `name`, in file order,
+     * until the function returns true. Usually there is at most one.
      */
-    template <class Return>
-    std::vector<Return> map_while(std::function<std::optional<Return>(NamedValue)> predicate);
+    void for_each_candidate(std::string_view name, const std::function<bool(Location)>& predicate) const;
 
-    /**
-     * Functions and classes that allow FileReader to be used as an iterator.
-     * You should not ever use these, just do `for (NamedPysonValue value : reader) { ... }`
-     * where `reader` is a FileReader. Range-based for loops like that are much more understantable
-     * and less bug prone than the old iterator-based for loops, so use them.
+    /// Number of distinct names in the index
+    size_t size() const noexcept { return m_size; }
+};
+
+/// What a FileReader should remember about where lines are, see FileReader::remember_offsets()
+struct OffsetTableOptions {
+    /// Remember where every Nth line starts (1 remembers every line, more uses less memory)
+    size_t checkpoint_interval = 64;
+    /// Also remember where each name is, so value_with_name() never reads a line twice
+    bool names = false;
+};
+
+/// How FileReader::read_ahead() should read ahead
+struct ReadAheadOptions {
+    /// Bytes the background thread reads at a time, into one buffer
+    size_t buffer_size = 4 << 20;
+    /// How many filled buffers can be waiting for the parser before the thread pauses (at least 1)
+    size_t depth = 2;
+};
+
+/**
+ * Which lines FileReader::scan() should hand over. Every check is made against the name and
+ * type tag, before the payload is converted, so lines that don't pass cost a search for
+ * two colons and nothing else (their payloads aren't checked either).
+ * A line has to pass every check that is set; a default ScanFilter lets everything through.
+ */
+struct ScanFilter {
+    /// Hashes std::string and std::string_view the same, so names can be looked up without a copy
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const noexcept { return std::hash<std::string_view>{}(name); }
+    };
+
+    /// The bit of a PysonType in `types`
+    static constexpr unsigned type_bit(PysonType type) noexcept { return 1u << static_cast<unsigned>(type); }
+    /// A `types` mask that lets every type through
+    static constexpr unsigned all_types = ~0u;
+
+    /// Only lines with one of these names, unless it's empty
+    std::unordered_set<std::string, NameHash, std::equal_to<>> names{};
+    /// Only lines whose name starts with this
+    std::string prefix{};
+    /// Only lines whose type's type_bit() is set
+    unsigned types = all_types;
+
+    /// Whether a line with this name and type passes the filter
+    bool accepts(std::string_view name, PysonType type) const noexcept {
+        if ((types & type_bit(type)) == 0) return false;
+        if (name.substr(0, prefix.size()) != prefix) return false;
+        return names.empty() || names.find(name) != names.end();
+    }
+};
+
+/**
+ * Counters a FileReader keeps about what it has done, see FileReader::stats().
+ * They are only collected when PYSON_STATS is defined to 1, otherwise they are always zero.
+ */
+struct ReaderStats {
+    /// Bytes read from the file, including lines that were skipped
+    uint64_t bytes_read = 0;
+    /// Lines parsed into values
+    uint64_t lines_parsed = 0;
+    /// Values parsed of each type
+    uint64_t ints = 0;
+    uint64_t floats = 0;
+    uint64_t strs = 0;
+    uint64_t lists = 0;
+    /// Lines that weren't valid pyson, or whole-file parses that failed (e.g. duplicate names in as_hashmap())
+    uint64_t parse_failures = 0;
+    /// Times the reader went back to the start of the file, including the ones
+    /// all(), as_hashmap(), load_document(), go_to_line() and value_with_name() do on their own
+    uint64_t rewinds = 0;
+    /// Times the reader jumped to a remembered line (from a NameIndex or remember_offsets())
+    uint64_t seeks = 0;
+    /// Lines read by go_to_line() and skip_n_lines() without being parsed
+    uint64_t lines_skipped = 0;
+    /// Lines scan() passed over without converting them, because they didn't match its filter
+    uint64_t lines_filtered = 0;
+    /// Time spent reading from the file
+    std::chrono::nanoseconds io_time{0};
+    /// Time spent parsing what was read
+    std::chrono::nanoseconds parse_time{0};
+};
+
+/// Something that wants to hear about a FileReader's ReaderStats, see FileReader::set_stats_sink()
+using StatsSink = std::function<void(const ReaderStats&)>;
+
+class FileReader {
+
+#if POSIX_FUNCTIONS_AVAILABLE
+    FILE *m_handle;
+
+    /// A getline() buffer that's kept between reads. Copying a FileReader doesn't copy it,
+    /// the copy just starts with its own empty buffer.
+    struct LineBuffer {
+        char *data = nullptr;
+        size_t capacity = 0;
+
+        LineBuffer() noexcept = default;
+        LineBuffer(const LineBuffer&) noexcept {}
+        LineBuffer& operator= (const LineBuffer&) noexcept { return *this; }
+        ~LineBuffer() noexcept { free((void*)data); }
+    };
+    LineBuffer m_line;
+
+    /// The background thread and buffers of read_ahead(), defined in pyson.cpp
+    class ReadAhead;
+    /// Owns the ReadAhead, if there is one. A copy of a FileReader doesn't read ahead, a moved one keeps reading ahead.
+    struct ReadAheadHandle {
+        ReadAhead *ptr = nullptr;
+
+        ReadAheadHandle() noexcept = default;
+        ReadAheadHandle(const ReadAheadHandle&) noexcept {}
+        ReadAheadHandle(ReadAheadHandle&& other) noexcept : ptr(other.ptr) { other.ptr = nullptr; }
+        ReadAheadHandle& operator= (const ReadAheadHandle&) noexcept;
+        ReadAheadHandle& operator= (ReadAheadHandle&& other) noexcept;
+        ~ReadAheadHandle() noexcept;
+    };
+    ReadAheadHandle m_read_ahead;
+#else
+    std::ifstream m_stream;
+    /// Line buffer that's kept between reads
+    std::string m_line;
+#endif
+
+    /// Storage next_into() can reuse when the type of the value it reads into changes
+    SpareStorage m_spare;
+
+    /// Index used by value_with_name(), if one was given to use_name_index()
+    std::optional<NameIndex> m_name_index;
+
+    /// Where lines and names are, filled in as the file gets read (see remember_offsets())
+    struct OffsetTable {
+        OffsetTableOptions options;
+        /// checkpoints[i] is the byte offset of line i * options.checkpoint_interval
+        std::vector<uint64_t> checkpoints;
+        /// The first line of each name out of lines [0, names_through)
+        std::unordered_map<std::string, NameIndex::Location> names;
+        uint64_t names_through;
+        /// Where line names_through starts
+        uint64_t names_resume_offset;
+        /// Whether names_through is the end of the file
+        bool names_complete;
+        /// Whether the reader knows which line it is at (it doesn't after all() for example)
+        bool position_known;
+        /// The line the reader is at and where it starts, if position_known
+        uint64_t line;
+        uint64_t offset;
+    };
+    std::optional<OffsetTable> m_offsets;
+
+#if PYSON_STATS
+    /// The counters, and the sink that gets told about them. A copy of a FileReader
+    /// starts with the same counters but no sink, so nothing is reported twice.
+    struct StatsState {
+        ReaderStats stats;
+        StatsSink sink;
+
+        StatsState() = default;
+        StatsState(const StatsState& other) : stats(other.stats), sink() {}
+        StatsState& operator= (const StatsState& other) { stats = other.stats; return *this; }
+        ~StatsState() noexcept { report(); }
+
+        void report() const noexcept { if (sink) sink(stats); }
+    };
+    StatsState m_stats;
+#endif
+
+    /// Rewind and read everything in the file into one buffer (used by all(), as_hashmap() and load_document())
+    std::pmr::string read_whole_file(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+    /// Continue reading from the start of a line
+    void go_to_offset(uint64_t offset, uint64_t line);
+    /**
+     * Read the next line (without its newline) into a view of the line buffer, and where it
+     * starts and ends in the file, or return false at the end of the file.
+     * The view is only valid until the next read.
+     */
+    bool read_line(std::string_view& line, uint64_t& start, uint64_t& end);
+    /// Read lines until one passes the filter and parse it into out, or return false at the end of the file
+    bool scan_next(const ScanFilter& filter, NamedValue& out, const char *invalid_message);
+    /// Read the next line into out (a NamedValue or a LazyNamedValue), or return false at the end of the file.
+    /// Throws invalid_message if the line isn't valid pyson.
+    template <class Record>
+    bool read_next(Record& out, const char *invalid_message);
+    /// Skip lines, throwing eof_message if the file ends first
+    void skip_lines(size_t amount, const char *eof_message);
+    /// The byte offset the next read will start at
+    uint64_t current_offset();
+    /// Tell the offset table that a line from start to end (and with name, if it was parsed) was read
+    void track_line(uint64_t start, uint64_t end, std::optional<std::string_view> name);
+    /// Tell the offset table that the end of the file was reached
+    void track_end() noexcept;
+
+public:
+    FileReader(const char *path);
+    FileReader(const std::string& path);
+
+#if POSIX_FUNCTIONS_AVAILABLE
+    /**
+     * A copy shares the file with the original and carries on from the same line.
+     * If the original is reading ahead, the file is moved to the original's position first
+     * (reading ahead doesn't move it), and the copy reads lines directly.
+     */
+    FileReader(const FileReader& other);
+    FileReader& operator= (const FileReader& other);
+    FileReader(FileReader&&) noexcept = default;
+    FileReader& operator= (FileReader&&) noexcept = default;
+#endif
+
+    /** 
+     * Get the next NamedValue from the file,
+     * or the null option if either the file ended.
+     * Throws an exception if the NamedValue is invalid.
+     */
+    std::optional<NamedValue> next();
+    /**
+     * Get the next NamedValue from the file,
+     * or a predetermined default NamedValue if the file ended.
+     * Throws an exception if the NamedValue is invalid.
+     */
+    NamedValue next_or(const NamedValue& default_value);
+    NamedValue next_or(NamedValue&& default_value);
+    /// Get the next NamedValue from the file,
+    /// or throw an exception if the file ended or the NamedValue is invalid
+    NamedValue next_or_throw();
+    /**
+     * Read the next NamedValue from the file into `out`,
+     * or return false (leaving `out` alone) if the file ended.
+     * Throws an exception if the NamedValue is invalid.
+     * The name, string, and list storage `out` already has are reused,
+     * so reading a file through the same NamedValue over and over doesn't need to allocate.
+     */
+    bool next_into(NamedValue& out);
+    /**
+     * Read the next NamedValue that passes a filter into `out` (see scan()),
+     * or return false (leaving `out` alone) if the file ended first.
+     */
+    bool next_into(const ScanFilter& filter, NamedValue& out);
+
+    /**
+     * Get the next line from the file as a LazyNamedValue, or the null option if the file ended.
+     * Only the name and type are checked here, the payload is converted when it's first looked at.
+     * Throws an exception if the line isn't formatted like name:type:value.
+     */
+    std::optional<LazyNamedValue> next_lazy();
+    /// Same as next_lazy(), but reads into `out` and reuses its storage, returning false at the end of the file
+    bool next_lazy_into(LazyNamedValue& out);
+    /**
+     * Same as all(), but every value is a LazyValue, so only the values that are
+     * looked at later get converted. This call will read the entire file.
+     */
+    std::vector<LazyNamedValue> all_lazy();
+
+    /**
+     * Get a vector that contains each NamedValue from the file.
+     * This call will read the entire file,
+     * not just the portion after the current read position.
+     */
+    std::vector<NamedValue> all();
+    /**
+     * Same as all(), but the file is split into chunks at line boundaries
+     * and the chunks are parsed on separate threads.
+     * The result is still in the same order as the file.
+     */
+    std::vector<NamedValue> all(ParallelOptions options);
+
+    /**
+     * Get a hashmap of each name to its Value from the file.
+     * This call will read the entire file,
+     * not just the portion after the current read position.
+     */
+    std::unordered_map<std::string, Value> as_hashmap();
+    /**
+     * Same as as_hashmap(), but the file is split into chunks at line boundaries
+     * and the chunks are parsed on separate threads.
+     * Duplicate names are still detected, even if they are in different chunks.
+     */
+    std::unordered_map<std::string, Value> as_hashmap(ParallelOptions options);
+
+    /**
+     * Read the entire file into a FrozenMap (not just the portion after the current read position).
+     * Throws an exception if the file has the same name more than once, like as_hashmap().
+     */
+    FrozenMap as_frozen_map();
+    /// Same as as_frozen_map(), but the file is parsed on several threads like all(ParallelOptions)
+    FrozenMap as_frozen_map(ParallelOptions options);
+
+    /**
+     * Read the entire file into a Document (not just the portion after the current read position).
+     * Everything is allocated from `resource` if one is given,
+     * otherwise from a monotonic arena that belongs to the Document.
+     */
+    Document load_document(std::pmr::memory_resource *resource = nullptr);
+
+    /// Read the entire file into a ColumnarTable (not just the portion after the current read position)
+    ColumnarTable load_columnar();
+
+    /// Reset read progress to the beginning of the file
+    void go_to_beginning();
+
+    /// Go to a specific line in the file, start reading from that line
+    /// Throws an exception if EOF is encountered before that line
+    void go_to_line(size_t line_number);
+
+    /// Skip the next N lines
+    void skip_n_lines(size_t amount_to_skip);
+
+    /**
+     * Start remembering where lines (and optionally names) are as the file gets read.
+     * Afterwards go_to_line() seeks to the closest remembered line at or before the
+     * one requested instead of reading from the beginning, and with options.names,
+     * value_with_name() looks up names it has already passed and only reads
+     * the part of the file it hasn't seen yet.
+     * Nothing is read by this call itself, the tables fill up as you read.
+     */
+    void remember_offsets(OffsetTableOptions options = {});
+
+    /**
+     * Locate the Value with a specific name from the file.
+     * The value will be found if it exists anywhere in the file,
+     * even before the current read location.
+     * The next Value read by next() will be the one after the value found.
+     */
+    std::optional<Value> value_with_name(const char *name);
+    std::optional<Value> value_with_name(const std::string& name) { return value_with_name(name.c_str()); }
+
+    /**
+     * Make value_with_name() look names up in a NameIndex instead of reading the whole file,
+     * so each lookup only reads the line it finds.
+     * The index should have been built from this file, e.g. with NameIndex::load_or_build().
+     */
+    void use_name_index(NameIndex index) { m_name_index = std::move(index); }
+
+    /**
+     * Start reading the file ahead on a background thread (with pread(), so the FILE itself isn't shared),
+     * so reading from the disk overlaps with parsing. The thread fills buffers of options.buffer_size
+     * bytes, keeping up to options.depth of them ready, and next(), iteration, scan() and the rest
+     * take their lines from those buffers. It pauses whenever the reader seeks, and starts again from
+     * the new position on the next read. all(), as_hashmap() and load_document() read the whole file
+     * in one go anyway, so they don't use it.
+     * Calling this again changes the options. Only POSIX systems can read ahead, elsewhere this does nothing.
+     */
+    void read_ahead(ReadAheadOptions options = {});
+    /// Stop reading ahead and go back to reading lines directly, from the same position
+    void stop_read_ahead();
+
+    /// A snapshot of the counters (all zero unless PYSON_STATS is defined to 1)
+    ReaderStats stats() const noexcept;
+    /// Set all the counters back to zero
+    void reset_stats() noexcept;
+    /**
+     * Call `sink` with the counters at the end of every all(), as_hashmap(), load_document(),
+     * go_to_line() and value_with_name(), and when the reader is destroyed.
+     * The sink must not throw. Does nothing unless PYSON_STATS is defined to 1.
+     */
+    void set_stats_sink(StatsSink sink);
+
+    /**
+     * Execute a function for each NamedValue left in the file.
+     * This function will not rewind to the beginning of the file.
+     */
+    void for_each(std::function<void(NamedValue)> predicate);
+
+    /**
+     * Get every NamedValue left in the file that passes a filter.
+     * Lines are checked by name and type before their payload is converted, so lines that
+     * don't pass are skipped without allocating or parsing numbers or lists.
+     * Throws an exception if a line isn't formatted like name:type:value, or a line that
+     * passes has an invalid payload. This function will not rewind to the beginning of the file.
+     */
+    std::vector<NamedValue> scan(const ScanFilter& filter);
+    /**
+     * Call a function with each NamedValue left in the file that passes a filter, like scan().
+     * The NamedValue is reused for the next line, so copy or move out of it to keep it.
+     * This function will not rewind to the beginning of the file.
+     */
+    void scan(const ScanFilter& filter, const std::function<void(NamedValue&)>& callback);
+    /**
+     * Same as scan() with a callback, but stops as soon as the callback returns false.
+     * This function will not rewind to the beginning of the file.
+     */
+    void scan_while(const ScanFilter& filter, const std::function<bool(NamedValue&)>& callback);
+
+    /**
+     * Map each NamedValue, and then get all of the results.
+     * This function will not rewind to the beginning of the file.
+     */
+    template <class Return>
+    std::vector<Return> map_each(std::function<Return(NamedValue)> predicate);
+
+    /**
+     * Call a function for each NamedValue left in the file while the function returns true.
+     * This function will not rewind to the beginning of the file.
+     */
+    void for_each_while(std::function<bool(NamedValue)> predicate);
+
+    /**
+     * Map each NamedValue while the function returns true and some Return value.
+     * Note: the last Return value will not be included in the result.
+     * This function will not rewind to the beginning of the file.
+     */
+    template <class Return>
+    std::vector<Return> map_while(std::function<std::pair<bool, Return>(NamedValue)> predicate);
+
+    /**
+     * Map each NamedValue while the function doesn't return std::nullopt.
+     * This function will not rewind to the beginning of the file.
+     */
+    template <class Return>
+    std::vector<Return> map_while(std::function<std::optional<Return>(NamedValue)> predicate);
+
+    /**
+     * Functions and classes that allow FileReader to be used as an iterator.
+     * You should not ever use these, just do `for (NamedPysonValue value : reader) { ... }`
+     * where `reader` is a FileReader. Range-based for loops like that are much more understantable
+     * and less bug prone than the old iterator-based for loops, so use them.
      * FileReader::begin() will NOT rewind the file despite the name.
      */
 
-    /// Dummy class required because != is a binary operator
+    /// Sentinel that an Iter compares equal to once the file has ended
     class End {};
     
-    /// Iterator over the NamedValue values in the file
+    /// Iterator over the NamedValue values in the file (a C++20 input iterator, with End as its sentinel)
     class Iter {
         /// Pointer to the inner reader
         FileReader *m_reader;
-        /// Cached next value
+        /// Cached next value, read into with next_into() so its storage gets reused
         NamedValue m_cached;
     
         /// Private constructor (only for use by FileReader)
@@ -452,12 +1497,21 @@ public:
         friend class FileReader;
 
     public:
+        using iterator_concept = std::input_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using value_type = NamedValue;
+        using difference_type = std::ptrdiff_t;
+        using reference = const NamedValue&;
+        using pointer = const NamedValue *;
+
         /// Increment: go to next iteration
-        void operator++();
-        /// Dereference: get the value
-        NamedValue operator*();
-        /// Not equal: check if the end has been reached
-        bool operator!=(const End& end);
+        Iter& operator++();
+        void operator++(int) { ++*this; }
+        /// Dereference: get the value (it's overwritten by the next increment)
+        const NamedValue& operator*() const;
+        const NamedValue *operator->() const { return &**this; }
+        /// Equal: check if the end has been reached (!= comes from this too)
+        bool operator==(const End&) const noexcept { return m_reader == nullptr; }
     };
 
     /// Begin iterator
@@ -466,6 +1520,1019 @@ public:
     End end();
 };
 
+/**
+ * A coroutine that yields references to T, one at a time, as a C++20 input range.
+ * Nothing runs until the first begin(), and each increment runs the coroutine up to its
+ * next co_yield, so records stream straight into range pipelines like std::views::filter
+ * or std::views::take without being collected anywhere.
+ * The yielded reference is only valid until the next increment (records() reuses one NamedValue).
+ * Exceptions thrown by the coroutine come out of begin() or operator++.
+ */
+template <class T>
+class Generator : public std::ranges::view_base {
+public:
+    struct promise_type {
+        const T *current = nullptr;
+        std::exception_ptr error;
+
+        Generator get_return_object() noexcept { return Generator(Handle::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(const T& value) noexcept {
+            current = std::addressof(value);
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+    };
+
+private:
+    using Handle = std::coroutine_handle<promise_type>;
+    Handle m_handle;
+
+    explicit Generator(Handle handle) noexcept : m_handle(handle) {}
+
+    /// Run the coroutine to its next co_yield (or its end), rethrowing what it threw
+    static void advance(Handle handle) {
+        handle.resume();
+        if (handle.promise().error) std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+    }
+
+public:
+    class Iter {
+        Handle m_handle;
+
+        explicit Iter(Handle handle) noexcept : m_handle(handle) {}
+        friend class Generator;
+
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using reference = const T&;
+
+        Iter() noexcept : m_handle() {}
+
+        Iter& operator++() {
+            advance(m_handle);
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+        const T& operator*() const noexcept { return *m_handle.promise().current; }
+        const T *operator->() const noexcept { return m_handle.promise().current; }
+        bool operator==(std::default_sentinel_t) const noexcept { return !m_handle || m_handle.done(); }
+    };
+
+    Generator() noexcept : m_handle() {}
+    Generator(Generator&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+    Generator& operator= (Generator&& other) noexcept {
+        if (this != &other) {
+            if (m_handle) m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+    ~Generator() { if (m_handle) m_handle.destroy(); }
+
+    /// Start the coroutine (only call this once, like any input range)
+    Iter begin() {
+        if (m_handle && !m_handle.done()) advance(m_handle);
+        return Iter(m_handle);
+    }
+    std::default_sentinel_t end() const noexcept { return std::default_sentinel; }
+};
+
+/**
+ * Stream every NamedValue left in the reader (it doesn't rewind), for example
+ * `for (const NamedValue& v : pyson::records(reader) | std::views::take(10))`.
+ * The reader has to outlive the generator. Throws an exception if a line is invalid.
+ */
+Generator<NamedValue> records(FileReader& reader);
+/// Same as records(), but only the lines that pass a filter, like FileReader::scan()
+Generator<NamedValue> records(FileReader& reader, ScanFilter filter);
+/// Same as records(), but yielding LazyNamedValues, like FileReader::next_lazy()
+Generator<LazyNamedValue> lazy_records(FileReader& reader);
+
+/**
+ * Fills as much of the buffer it's given as it can and returns how many bytes it wrote,
+ * or 0 once there is nothing left (e.g. a wrapper around read() on a pipe or a socket).
+ */
+using ReadMore = std::function<size_t(std::span<char>)>;
+/**
+ * Stream NamedValues out of pyson text that arrives in pieces: whenever the buffered text
+ * runs out of complete lines, read_more is called to get more.
+ * Throws an exception if a line is invalid, or whatever read_more throws.
+ */
+Generator<NamedValue> records(ReadMore read_more, size_t buffer_size = 1 << 16);
+
+/// Hints for how a MappedFileReader should map its file
+struct MapOptions {
+    /// Ask the OS to read the whole file in up front (MAP_POPULATE, only on Linux)
+    bool populate = false;
+    /// Tell the OS the file will be read from front to back (madvise(MADV_SEQUENTIAL))
+    bool sequential = true;
+};
+
+/**
+ * The memory (mapped or otherwise) behind a MappedFileReader.
+ * On unix the file is mmapped, everywhere else it is read into a buffer.
+ * As a user of pyson, you will never need to use this directly.
+ */
+class FileMapping {
+    const char *m_data;
+    size_t m_size;
+#if !POSIX_FUNCTIONS_AVAILABLE
+    std::string m_buffer;
+#endif
+
+public:
+    FileMapping(const char *path, MapOptions options);
+    ~FileMapping() noexcept;
+
+    FileMapping(const FileMapping&) = delete;
+    FileMapping& operator= (const FileMapping&) = delete;
+    FileMapping(FileMapping&& other) noexcept;
+    FileMapping& operator= (FileMapping&& other) noexcept;
+
+    const char *data() const noexcept { return m_data; }
+    size_t size() const noexcept { return m_size; }
+};
+
+/**
+ * A reader that maps the whole file into memory and hands out NamedValueViews into it.
+ * Reading a line with a MappedFileReader never allocates; the only copies made are
+ * the ones you ask for with NamedValueView::to_value() or NamedValueView::to_named_value().
+ * Views returned by a MappedFileReader are valid for as long as the reader is alive.
+ */
+class MappedFileReader {
+    FileMapping m_mapping;
+    size_t m_position;
+
+public:
+    explicit MappedFileReader(const char *path, MapOptions options = {});
+    explicit MappedFileReader(const std::string& path, MapOptions options = {})
+        : MappedFileReader(path.c_str(), options) {}
+
+    /**
+     * Get a view of the next NamedValue in the file,
+     * or the null option if the file ended.
+     * Throws an exception if the line isn't formatted correctly.
+     */
+    std::optional<NamedValueView> next();
+
+    /**
+     * Get a vector that contains an owning copy of each NamedValue in the file.
+     * Like FileReader::all(), this reads the entire file,
+     * not just the portion after the current read position.
+     */
+    std::vector<NamedValue> all();
+
+    /// Reset read progress to the beginning of the file
+    void go_to_beginning() noexcept { m_position = 0; }
+
+    /// The whole mapped file
+    std::string_view contents() const noexcept { return std::string_view(m_mapping.data(), m_mapping.size()); }
+
+    /// Dummy class required because != is a binary operator
+    class End {};
+
+    /// Iterator over the views in the file, works the same as FileReader::Iter
+    class Iter {
+        MappedFileReader *m_reader;
+        NamedValueView m_cached;
+
+        Iter(MappedFileReader *reader);
+        friend class MappedFileReader;
+
+    public:
+        using iterator_concept = std::input_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using value_type = NamedValueView;
+        using difference_type = std::ptrdiff_t;
+        using reference = NamedValueView;
+
+        /// Increment: go to next iteration
+        Iter& operator++();
+        void operator++(int) { ++*this; }
+        /// Dereference: get the view
+        NamedValueView operator*() const;
+        /// Equal: check if the end has been reached (!= comes from this too)
+        bool operator==(const End&) const noexcept { return m_reader == nullptr; }
+    };
+
+    /// Begin iterator (doesn't rewind)
+    Iter begin() { return Iter(this); }
+    /// End value
+    End end() { return End{}; }
+};
+
+/// How a SharedFileReader is opened
+struct SharedReaderOptions {
+    /// Find where every line starts when the file is opened, so lines can be read by number
+    bool index_lines = false;
+    /// Load the file's NameIndex sidecar (building it if it's missing or stale) for value_with_name()
+    bool name_index = false;
+    /// Bytes a Cursor reads from the file at a time
+    size_t cursor_buffer_size = 1 << 16;
+};
+
+/**
+ * A reader for one open file that any number of threads can use at once.
+ * Unlike FileReader, it has no read position of its own: every read says where in the file
+ * it starts, and reads with pread(), so nothing is shared between reads but the file descriptor.
+ * Sequential reading goes through a Cursor, which is cheap to make, so each thread can have its own.
+ * The line table (SharedReaderOptions::index_lines) and the NameIndex are made when the file is
+ * opened and never change afterwards; lines appended later can still be read by offset.
+ * Where pread() isn't available (Windows), reads take turns on one std::ifstream instead.
+ */
+class SharedFileReader {
+public:
+    class Cursor;
+
+private:
+    std::string m_path;
+    SharedReaderOptions m_options;
+#if POSIX_FUNCTIONS_AVAILABLE
+    int m_fd;
+#else
+    mutable std::mutex m_stream_mutex;
+    mutable std::ifstream m_stream;
+#endif
+    /// Where each line starts, if the lines were indexed
+    std::vector<uint64_t> m_line_starts;
+    std::optional<NameIndex> m_name_index;
+
+    /// Read up to `length` bytes at `offset`, returns how many there were (0 at the end of the file)
+    size_t read_bytes(uint64_t offset, char *out, size_t length) const;
+    /// Where a line starts, throws if the lines aren't indexed or there is no such line
+    uint64_t line_start(size_t line, const char *caller) const;
+
+public:
+    /**
+     * Open a file to share.
+     * Throws an exception if the file can't be opened, or indexing it fails.
+     */
+    explicit SharedFileReader(const char *path, SharedReaderOptions options = {});
+    explicit SharedFileReader(const std::string& path, SharedReaderOptions options = {})
+        : SharedFileReader(path.c_str(), options) {}
+    ~SharedFileReader() noexcept;
+
+    SharedFileReader(const SharedFileReader&) = delete;
+    SharedFileReader& operator= (const SharedFileReader&) = delete;
+
+    /// A Cursor that reads from the line starting at a byte offset
+    Cursor cursor(uint64_t offset = 0) const;
+    /// A Cursor that reads from a line number, needs SharedReaderOptions::index_lines
+    Cursor cursor_at_line(size_t line) const;
+
+    /**
+     * Read the line starting at a byte offset, or get the null option at the end of the file.
+     * Throws an exception if the line isn't formatted correctly.
+     */
+    std::optional<NamedValue> read_at(uint64_t offset) const;
+    /**
+     * Read a line by number (starting at 0), needs SharedReaderOptions::index_lines.
+     * Throws a std::out_of_range if the file had fewer lines when it was opened.
+     */
+    NamedValue read_line(size_t line) const;
+    /// Number of lines when the file was opened, needs SharedReaderOptions::index_lines
+    size_t line_count() const;
+
+    /**
+     * Get the value of the first NamedValue with a name, or a null option if there isn't one.
+     * Uses the NameIndex if there is one, otherwise reads the file from the start.
+     */
+    std::optional<Value> value_with_name(std::string_view name) const;
+    /// Read every NamedValue in the file
+    std::vector<NamedValue> all() const;
+};
+
+/**
+ * One thread's read position in a SharedFileReader, with its own buffer.
+ * A Cursor isn't thread-safe itself, and must not outlive its SharedFileReader.
+ */
+class SharedFileReader::Cursor {
+    const SharedFileReader *m_reader;
+    /// Where in the file m_buffer starts
+    uint64_t m_buffer_offset;
+    std::string m_buffer;
+    /// Where the next line starts in m_buffer
+    size_t m_position;
+    SpareStorage m_spare;
+
+    friend class SharedFileReader;
+    Cursor(const SharedFileReader *reader, uint64_t offset);
+
+    /// Get the next line (without its newline), false at the end of the file
+    bool next_line(std::string_view& line);
+
+public:
+    /**
+     * Get the next NamedValue, or the null option at the end of the file.
+     * Throws an exception if the line isn't formatted correctly.
+     */
+    std::optional<NamedValue> next();
+    /**
+     * Read the next NamedValue into `out`, reusing the memory it already has.
+     * Returns false at the end of the file, throws like next().
+     */
+    bool next_into(NamedValue& out);
+
+    /// Carry on reading from the line starting at a byte offset
+    void seek(uint64_t offset);
+    /// Carry on reading from a line number, needs SharedReaderOptions::index_lines
+    void go_to_line(size_t line);
+    /// Byte offset of the next line
+    uint64_t offset() const noexcept { return m_buffer_offset + m_position; }
+};
+
+/// How a FileWriter should write its file
+struct WriterOptions {
+    /// How many bytes to collect before writing them to the file
+    size_t buffer_size = 1 << 20;
+    /**
+     * Write to a temporary file next to the real one (the path with ".tmp." and a suffix
+     * unique to this writer added, so writers replacing the same file don't collide),
+     * and only rename it over the real file in commit().
+     * Readers of the real file then see either the whole old file or the whole new one.
+     */
+    bool atomic_replace = false;
+};
+
+/**
+ * Writes NamedValues to a file in the pyson format.
+ * Lines are formatted straight into a buffer of WriterOptions::buffer_size bytes,
+ * which is only written to the file when it fills up, on flush(), or on commit().
+ * If the FileWriter is destroyed without commit(), a normal file is still flushed and closed,
+ * but an atomic_replace one is thrown away, leaving the real file as it was.
+ */
+class FileWriter {
+    std::string m_path;
+    std::string m_write_path;
+    FILE *m_handle;
+    std::string m_buffer;
+    WriterOptions m_options;
+
+    /// Format one line onto the end of the buffer
+    void append_line(std::string_view name, const Value& value);
+    /// Write out the buffer if it's full
+    void flush_if_full();
+    /// Close the file, returns false if that failed
+    bool close() noexcept;
+
+public:
+    explicit FileWriter(const char *path, WriterOptions options = {});
+    explicit FileWriter(const std::string& path, WriterOptions options = {})
+        : FileWriter(path.c_str(), options) {}
+    ~FileWriter() noexcept;
+
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator= (const FileWriter&) = delete;
+
+    /**
+     * Write one value with a name.
+     * Throws an exception if the result wouldn't be valid pyson or wouldn't read back the same:
+     * a name containing ':' or a newline, a string or list element containing a newline,
+     * an empty list, a list element containing "(*)", or an empty list element that isn't the last one.
+     */
+    void write(std::string_view name, const Value& value);
+    void write(const NamedValue& value) { write(value.m_name, value.m_value); }
+    /// Write several NamedValues in order
+    void write_batch(std::span<const NamedValue> values);
+
+    /// Write everything buffered so far to the file
+    void flush();
+    /**
+     * Finish writing: flush, close the file, and with atomic_replace,
+     * rename the temporary file over the real one.
+     * Nothing can be written after this.
+     */
+    void commit();
+};
+
+/// How a FollowReader reads and waits
+struct FollowOptions {
+    /// Start at the end of the file as it is now, instead of at start_offset
+    static constexpr uint64_t end = UINT64_MAX;
+    /// Byte offset to start reading at, like a FollowReader::offset() saved earlier
+    uint64_t start_offset = 0;
+    /// How often to check the file when inotify isn't available (everywhere but Linux)
+    std::chrono::milliseconds poll_interval{100};
+    /// Most bytes to read from the file at once
+    size_t read_size = 1 << 16;
+};
+
+/**
+ * Reads a pyson file that other processes keep appending to, like `tail -F`.
+ * The reader remembers how far it has read, and only ever reads what was appended since.
+ * A line is only parsed once its newline has been written; a partial last line
+ * is kept until the rest of it arrives.
+ * On Linux, waiting for more lines uses inotify; everywhere else (or if inotify
+ * can't be used) the file size is checked every FollowOptions::poll_interval.
+ * If the file gets shorter, it was truncated, so reading starts over at the beginning.
+ * On unix, if the path is replaced by a new file (log rotation), the new file is read from the start.
+ */
+class FollowReader {
+    std::string m_path;
+    FollowOptions m_options;
+#if POSIX_FUNCTIONS_AVAILABLE
+    int m_fd;
+    /// inotify instance and the watch on the file, -1 if there isn't one
+    int m_notify_fd;
+    int m_watch;
+#else
+    std::ifstream m_file;
+#endif
+    /// Where in the file the bytes read so far end
+    uint64_t m_read_offset;
+    /// Bytes read but not returned yet, starting at m_pending_start
+    std::string m_pending;
+    size_t m_pending_start;
+    SpareStorage m_spare;
+
+    /// Read whatever was appended since the last read, returns whether anything was
+    bool read_available();
+    /// Same as read_available(), but if there was nothing, also check whether the file was replaced
+    bool read_more();
+    /// Whether the file's size is different from what has been read, or the path is a different file now
+    bool file_changed() const;
+    /// Take the next complete line out of m_pending, if there is one
+    std::optional<std::string_view> take_line();
+    /// Start over from the beginning of the file (after truncation or rotation)
+    void restart() noexcept;
+#if POSIX_FUNCTIONS_AVAILABLE
+    /// If the path is a different file now (log rotation), open that one instead
+    bool reopen_if_replaced();
+    /// Read every queued inotify event, dropping the watch if the file was moved or deleted
+    void drain_events() noexcept;
+#endif
+
+public:
+    /**
+     * Open a file to follow.
+     * Throws an exception if the file can't be opened.
+     */
+    explicit FollowReader(const char *path, FollowOptions options = {});
+    explicit FollowReader(const std::string& path, FollowOptions options = {})
+        : FollowReader(path.c_str(), options) {}
+    ~FollowReader() noexcept;
+
+    FollowReader(const FollowReader&) = delete;
+    FollowReader& operator= (const FollowReader&) = delete;
+
+    /**
+     * Get the next NamedValue if a complete line is available right now,
+     * or the null option if not. Never waits.
+     * Throws an exception if the line isn't formatted correctly; the line is skipped,
+     * so the next call carries on after it.
+     */
+    std::optional<NamedValue> try_next();
+    /**
+     * Get the next NamedValue, waiting up to `timeout` for one to be appended,
+     * or the null option if none was.
+     * Throws an exception if the line isn't formatted correctly, like try_next().
+     */
+    std::optional<NamedValue> next(std::chrono::milliseconds timeout);
+    /**
+     * Append every NamedValue that is complete right now to `out`, returns how many there were.
+     * Throws an exception if a line isn't formatted correctly, like try_next();
+     * the values before that line are still appended.
+     */
+    size_t poll(std::vector<NamedValue>& out);
+
+    /**
+     * Wait until the file changes or `timeout` passes, returns false if it timed out.
+     * A true result doesn't promise a complete line, only that there's something new to look at.
+     */
+    bool wait(std::chrono::milliseconds timeout);
+
+    /// Byte offset of the first line not returned yet, to pass as FollowOptions::start_offset later
+    uint64_t offset() const noexcept { return m_read_offset - (m_pending.size() - m_pending_start); }
+};
+
+/// How a LiveConfig reloads its file
+struct LiveConfigOptions {
+    /// How often a background thread checks whether the file changed, 0 for no background thread
+    std::chrono::milliseconds check_interval{1000};
+    /**
+     * Called on the background thread when reloading the changed file fails
+     * (for example because it isn't valid pyson). The old snapshot stays published,
+     * and that version of the file isn't tried again; the next change to it is.
+     */
+    std::function<void(const std::exception&)> on_error;
+};
+
+/**
+ * A config file loaded into immutable FrozenMap snapshots that many threads can read
+ * while the file is reloaded. A reload builds the next snapshot off to the side and then
+ * swaps it in, so readers never wait for one; a reader keeps using the snapshot it has
+ * until it asks for the current one again, and old snapshots are freed when the last
+ * reader lets go of them.
+ * Reloads happen when reload() or reload_if_changed() is called, and, unless
+ * LiveConfigOptions::check_interval is 0, on a background thread when the file's size
+ * or modification time changes.
+ *
+ * snapshot() costs a shared_ptr copy. Request threads should each get a Reader instead:
+ * while nothing was reloaded, Reader::current() is a single atomic load,
+ * with no locks and no reference counts shared between threads.
+ * Whatever writes the file should use WriterOptions::atomic_replace,
+ * so a reload never sees it half-written.
+ */
+class LiveConfig {
+public:
+    class Reader;
+
+private:
+    std::string m_path;
+    LiveConfigOptions m_options;
+    /// Guards m_current, only held while the pointer is copied or replaced
+    mutable std::mutex m_current_mutex;
+    std::shared_ptr<const FrozenMap> m_current;
+    /// Incremented after every new snapshot is published
+    std::atomic<uint64_t> m_generation;
+    /// Only one reload at a time, guards the stamps
+    std::mutex m_reload_mutex;
+    /// Size and modification time of the file when it was last loaded, and when loading it last failed
+    uint64_t m_loaded_size;
+    int64_t m_loaded_mtime;
+    uint64_t m_failed_size;
+    int64_t m_failed_mtime;
+    /// The background thread and what it waits on
+    std::mutex m_stop_mutex;
+    std::condition_variable m_stop_condition;
+    bool m_stop;
+    std::thread m_thread;
+
+    /// Load the file and publish it, with m_reload_mutex held
+    void load(uint64_t size, int64_t mtime);
+    /// What the background thread runs
+    void watch();
+
+public:
+    /**
+     * Load a file and, if LiveConfigOptions::check_interval isn't 0, start watching it.
+     * Throws an exception if the file can't be loaded, like FileReader::as_frozen_map().
+     */
+    explicit LiveConfig(const char *path, LiveConfigOptions options = {});
+    explicit LiveConfig(const std::string& path, LiveConfigOptions options = {})
+        : LiveConfig(path.c_str(), std::move(options)) {}
+    /// Stops the background thread
+    ~LiveConfig() noexcept;
+
+    LiveConfig(const LiveConfig&) = delete;
+    LiveConfig& operator= (const LiveConfig&) = delete;
+
+    /// The current snapshot, it stays valid for as long as it's held
+    std::shared_ptr<const FrozenMap> snapshot() const;
+    /// How many snapshots have been published, counting the first one
+    uint64_t generation() const noexcept { return m_generation.load(std::memory_order_acquire); }
+    /// A Reader for one thread, it must not outlive the LiveConfig
+    Reader reader() const;
+
+    /// Copy a value out of the current snapshot, or get the null option if there isn't one with that name
+    std::optional<Value> get(std::string_view name) const;
+
+    /**
+     * Load the file again and publish it, even if it didn't change.
+     * Throws an exception if the file can't be loaded; the old snapshot stays published.
+     */
+    void reload();
+    /**
+     * Load the file again if its size or modification time changed, returns whether it was.
+     * Throws an exception like reload().
+     */
+    bool reload_if_changed();
+};
+
+/**
+ * One thread's view of a LiveConfig, see LiveConfig.
+ * A Reader isn't thread-safe itself: give each thread its own.
+ */
+class LiveConfig::Reader {
+    const LiveConfig *m_config;
+    uint64_t m_generation;
+    std::shared_ptr<const FrozenMap> m_snapshot;
+
+    friend class LiveConfig;
+    explicit Reader(const LiveConfig *config);
+
+public:
+    /**
+     * The current snapshot. It's the same one as last time unless a reload was published since,
+     * and stays valid until the next call (or until the Reader is destroyed).
+     */
+    const FrozenMap& current() {
+        uint64_t generation = m_config->m_generation.load(std::memory_order_acquire);
+        if (generation != m_generation) {
+            m_snapshot = m_config->snapshot();
+            m_generation = generation;
+        }
+        return *m_snapshot;
+    }
+    /// Get a value from the current snapshot, or nullptr if there isn't one with that name
+    const Value *find(std::string_view name) { return current().find(name); }
+};
+
+/// One file loaded by pyson::load_many()
+struct LoadResult {
+    /// The path the file was loaded from
+    std::string path;
+    /// Everything in the file, or an empty map if it couldn't be loaded
+    FrozenMap values;
+    /// Why the file couldn't be loaded (the exception message), empty if it was
+    std::string error;
+
+    /// Returns whether the file was loaded
+    bool ok() const noexcept { return error.empty(); }
+    explicit operator bool() const noexcept { return ok(); }
+};
+
+/**
+ * Load many pyson files into FrozenMaps at once, like calling FileReader::as_frozen_map() on each.
+ * The files are parsed on a pool of options.threads threads that steal work from each other,
+ * biggest files first, and files bigger than options.min_chunk_size are split at line boundaries
+ * into chunks that are parsed as separate tasks, so a few huge files don't hold up the rest.
+ * A file that can't be read, isn't valid pyson, or has a name more than once gets its error
+ * in its LoadResult and doesn't stop the others from loading.
+ * The results are in the same order as the paths.
+ */
+std::vector<LoadResult> load_many(std::span<const std::string> paths, ParallelOptions options = {});
+
+/**
+ * Convert a pyson file into the compiled binary format read by BinaryReader.
+ * The text file stays the source of truth: the compiled file remembers the size and
+ * modification time of the text it was made from (see BinaryReader::is_compiled_from()).
+ * The compiled file is written next to bin_path and renamed over it when it's complete,
+ * so a BinaryReader never maps half a file.
+ * Throws an exception if the text file can't be read or isn't valid pyson,
+ * or if the compiled file can't be written.
+ */
+void compile(const char *text_path, const char *bin_path);
+inline void compile(const std::string& text_path, const std::string& bin_path) {
+    compile(text_path.c_str(), bin_path.c_str());
+}
+
+/**
+ * A reader for compiled pyson files (".pysonb", made with pyson::compile()).
+ * The file is mapped into memory and nothing in it is parsed: ints and floats are stored raw,
+ * names, strings and list elements are offsets into a blob, and value_with_name() uses
+ * a hash index stored in the file. Opening the file checks that every offset in it is in bounds
+ * and builds the table of list element views; after that, every accessor is a couple of loads.
+ * Compiled files use the byte order of the machine that compiled them,
+ * and are rejected by machines with a different one.
+ * Views returned by a BinaryReader are valid for as long as the reader is alive.
+ */
+class BinaryReader {
+    FileMapping m_mapping;
+    size_t m_record_count;
+    size_t m_slot_count;
+    /// Where the index slots and the blob start in the mapping
+    size_t m_slots_offset;
+    size_t m_blob_offset;
+    uint64_t m_source_size;
+    int64_t m_source_mtime;
+    std::vector<std::string_view> m_list_elements;
+
+    /// Check the header and every record, and fill in m_list_elements
+    void validate();
+
+public:
+    /// The usual path of the compiled version of a pyson file ("config.pyson" becomes "config.pysonb")
+    static std::string compiled_path(const std::string& pyson_path) {
+        if (pyson_path.ends_with(".pyson")) return pyson_path + "b";
+        return pyson_path + ".pysonb";
+    }
+
+    /**
+     * Map a compiled pyson file.
+     * Throws an exception if the file can't be mapped, isn't a compiled pyson file,
+     * was compiled on a machine with a different byte order, or is corrupt.
+     */
+    explicit BinaryReader(const char *path, MapOptions options = MapOptions{false, false});
+    explicit BinaryReader(const std::string& path, MapOptions options = MapOptions{false, false})
+        : BinaryReader(path.c_str(), options) {}
+
+    /**
+     * Map the compiled version of a pyson file if it's still up to date,
+     * otherwise compile it again first.
+     */
+    static BinaryReader open_or_compile(const char *text_path, const char *bin_path,
+                                        MapOptions options = MapOptions{false, false});
+    static BinaryReader open_or_compile(const std::string& text_path, const std::string& bin_path,
+                                        MapOptions options = MapOptions{false, false}) {
+        return open_or_compile(text_path.c_str(), bin_path.c_str(), options);
+    }
+
+    /// Whether the compiled file was made from the current version of a pyson file
+    bool is_compiled_from(const char *text_path) const;
+    bool is_compiled_from(const std::string& text_path) const { return is_compiled_from(text_path.c_str()); }
+
+    /// Number of NamedValues in the file
+    size_t size() const noexcept { return m_record_count; }
+    /// The name of the NamedValue at index i
+    std::string_view name(size_t i) const;
+    /// The value of the NamedValue at index i
+    ValueView value(size_t i) const;
+    /// The NamedValue at index i, copied into an owning NamedValue
+    NamedValue named_value(size_t i) const;
+
+    /// Index of the first NamedValue with a name, or a null option if there isn't one
+    std::optional<size_t> find(std::string_view name) const;
+    /// Get the value of the first NamedValue with a name, or a null option if there isn't one
+    std::optional<ValueView> value_with_name(std::string_view name) const;
+};
+
+/// What went wrong when binding a file to a Schema
+enum class BindError : unsigned char {
+    /// Nothing, the whole file was bound
+    None,
+    /// A line isn't formatted like name:type:value, or its type isn't int, float, str, or list
+    InvalidLine,
+    /// A field's payload isn't valid for its type, like an int that isn't a number
+    InvalidValue,
+    /// A field's line has a different type than the field
+    WrongType,
+    /// A line's name isn't one of the fields (only without SchemaOptions::ignore_unknown)
+    UnknownName,
+    /// A field's name is on more than one line
+    DuplicateName,
+    /// A field isn't in the file at all (only with SchemaOptions::require_all)
+    MissingField,
+};
+
+/**
+ * The outcome of binding a file to a Schema.
+ * Binding stops at the first problem and reports it here instead of throwing,
+ * the fields bound before that keep their new values.
+ */
+struct BindResult {
+    BindError error = BindError::None;
+    /// The line the problem is on, starting at 0 (for MissingField, the number of lines in the file)
+    size_t line = 0;
+    /// The name on that line, or the name of the missing field
+    std::string name;
+    /// For WrongType, the type of the field and the type in the file
+    PysonType expected = PysonType::PysonInt;
+    PysonType found = PysonType::PysonInt;
+
+    /// Returns whether the whole file was bound
+    bool ok() const noexcept { return error == BindError::None; }
+    explicit operator bool() const noexcept { return ok(); }
+    /// Describe the problem in words, for logs and error messages
+    std::string message() const;
+};
+
+/// How Schema::bind() treats names and fields that don't match up
+struct SchemaOptions {
+    /// Skip lines whose name isn't a field, instead of stopping with BindError::UnknownName
+    bool ignore_unknown = true;
+    /// Stop with BindError::MissingField if a field isn't in the file
+    bool require_all = false;
+};
+
+/**
+ * A string literal that can be a template argument, so fields can be written as field<"port", ...>.
+ * As a user of pyson, you will never need to use this directly.
+ */
+template <size_t N>
+struct FixedString {
+    char chars[N];
+
+    constexpr FixedString(const char (&str)[N]) noexcept : chars() {
+        for (size_t i = 0; i < N; i++) chars[i] = str[i];
+    }
+    constexpr std::string_view view() const noexcept { return std::string_view(chars, N - 1); }
+};
+
+/// Compile-time helpers for Schema, as a user of pyson you will never need these directly
+namespace schema_detail {
+
+template <class Pointer>
+struct MemberPointer;
+template <class Struct, class Member>
+struct MemberPointer<Member Struct::*> {
+    using struct_type = Struct;
+    using member_type = Member;
+};
+
+template <class Member>
+constexpr bool is_bindable = std::is_same_v<Member, int> || std::is_same_v<Member, double>
+    || std::is_same_v<Member, std::string> || std::is_same_v<Member, std::vector<std::string>>;
+
+template <class Member>
+constexpr PysonType type_of() noexcept {
+    if constexpr (std::is_same_v<Member, int>) return PysonType::PysonInt;
+    else if constexpr (std::is_same_v<Member, double>) return PysonType::PysonFloat;
+    else if constexpr (std::is_same_v<Member, std::string>) return PysonType::PysonStr;
+    else return PysonType::PysonList;
+}
+
+/// FNV-1a, done once per name; the seed only comes in when the hash is turned into a slot
+constexpr uint64_t hash(std::string_view name) noexcept {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/// Mix a name's hash with a seed, so every seed spreads the names differently over the table
+constexpr size_t slot(uint64_t hash, uint64_t seed, size_t table_size) noexcept {
+    uint64_t mixed = hash ^ (seed * 0x9E3779B97F4A7C15ull);
+    mixed ^= mixed >> 32;
+    mixed *= 0xD6E8FEB86659FD93ull;
+    mixed ^= mixed >> 32;
+    return static_cast<size_t>(mixed & (table_size - 1));
+}
+
+struct HashParameters {
+    /// A power of two, or 0 if there is no perfect hash because two names are the same
+    size_t table_size;
+    uint64_t seed;
+};
+
+/// The smallest table (and a seed for it) where every name gets a slot of its own
+template <size_t N>
+constexpr HashParameters find_hash_parameters(const std::array<std::string_view, N>& names) noexcept {
+    std::array<uint64_t, N> hashes{};
+    for (size_t i = 0; i < N; i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (names[i] == names[j]) return HashParameters{0, 0};
+        }
+        hashes[i] = hash(names[i]);
+    }
+    // most seeds work once the table has about N * N slots, so the search stops well before max_size
+    constexpr size_t max_size = [] {
+        size_t size = 64;
+        while (size < 4 * N * N) size *= 2;
+        return size;
+    }();
+    std::array<uint64_t, max_size / 64> used{};
+    size_t table_size = 1;
+    while (table_size < N) table_size *= 2;
+    for (; table_size <= max_size; table_size *= 2) {
+        for (uint64_t seed = 0; seed < 64; seed++) {
+            for (size_t word = 0; word <= (table_size - 1) / 64; word++) used[word] = 0;
+            bool collision = false;
+            for (size_t i = 0; i < N && !collision; i++) {
+                size_t s = slot(hashes[i], seed, table_size);
+                collision = (used[s / 64] >> (s % 64)) & 1;
+                used[s / 64] |= uint64_t{1} << (s % 64);
+            }
+            if (!collision) return HashParameters{table_size, seed};
+        }
+    }
+    return HashParameters{0, 0};
+}
+
+/// Slot -> field index + 1, 0 for an empty slot
+template <size_t TableSize, size_t N>
+constexpr std::array<uint16_t, TableSize> build_table(const std::array<std::string_view, N>& names, uint64_t seed) noexcept {
+    std::array<uint16_t, TableSize> table{};
+    for (size_t i = 0; i < N; i++)
+        table[slot(hash(names[i]), seed, TableSize)] = static_cast<uint16_t>(i + 1);
+    return table;
+}
+
+}
+
+/**
+ * One field of a Schema: a name in the file, and the struct member it's stored in.
+ * The member has to be an int, a double, a std::string or a std::vector<std::string>,
+ * for the pyson types int, float, str and list.
+ * Write it as pyson::field<"name", &Struct::member>.
+ */
+template <FixedString Name, auto Member>
+struct Field {
+    using struct_type = typename schema_detail::MemberPointer<decltype(Member)>::struct_type;
+    using member_type = typename schema_detail::MemberPointer<decltype(Member)>::member_type;
+    static_assert(schema_detail::is_bindable<member_type>,
+        "A pyson field has to be an int, double, std::string or std::vector<std::string>");
+    static_assert(Name.view().find_first_of(":\n") == std::string_view::npos,
+        "A pyson field name can't contain ':' or a newline");
+
+    static constexpr std::string_view name = Name.view();
+    static constexpr PysonType type = schema_detail::type_of<member_type>();
+    static constexpr auto member = Member;
+};
+
+template <FixedString Name, auto Member>
+inline constexpr Field<Name, Member> field{};
+
+/**
+ * Binds pyson files to a struct, made with pyson::schema():
+ *
+ *     constexpr auto config_schema = pyson::schema<Config>(
+ *         pyson::field<"port", &Config::port>,
+ *         pyson::field<"host", &Config::host>
+ *     );
+ *     Config config{};
+ *     pyson::BindResult result = config_schema.bind_file("config.pyson", config);
+ *
+ * The names are put in a perfect hash table at compile time, so finding a line's field
+ * is one hash and one string comparison. Payloads are converted straight into the members
+ * (NamedValueView::decode_into()), without making a Value, a NamedValue, or a hashmap.
+ * Type mismatches and other problems are reported in the BindResult instead of thrown;
+ * only failing to read the file throws.
+ */
+template <class T, class... Fields>
+class Schema {
+    static constexpr size_t field_count = sizeof...(Fields);
+    static_assert(field_count > 0, "A pyson::Schema needs at least one field");
+    static_assert(field_count < UINT16_MAX, "A pyson::Schema can't have that many fields");
+    static_assert((std::is_base_of_v<typename Fields::struct_type, T> && ...),
+        "Every field of a pyson::Schema has to be a member of its struct");
+
+    static constexpr std::array<std::string_view, field_count> names{Fields::name...};
+    static constexpr std::array<PysonType, field_count> types{Fields::type...};
+    static constexpr schema_detail::HashParameters hashing = schema_detail::find_hash_parameters(names);
+    static_assert(hashing.table_size != 0, "Two fields of a pyson::Schema have the same name");
+    static constexpr std::array<uint16_t, hashing.table_size> table =
+        schema_detail::build_table<hashing.table_size>(names, hashing.seed);
+
+    template <class F>
+    static bool decode(const NamedValueView& view, T& out) { return view.decode_into(out.*F::member); }
+    using Decoder = bool (*)(const NamedValueView&, T&);
+    static constexpr std::array<Decoder, field_count> decoders{&decode<Fields>...};
+
+    static BindResult failure(BindError error, size_t line, std::string_view name) {
+        BindResult result{};
+        result.error = error;
+        result.line = line;
+        result.name = std::string(name);
+        return result;
+    }
+
+public:
+    /// Number of fields
+    static constexpr size_t size() noexcept { return field_count; }
+    /// The name of field i, in the order they were given to pyson::schema()
+    static constexpr std::string_view field_name(size_t i) { return names.at(i); }
+    /// The type of field i
+    static constexpr PysonType field_type(size_t i) { return types.at(i); }
+    /// The index of the field with a name, or a null option if no field has it
+    static constexpr std::optional<size_t> field_index(std::string_view name) noexcept {
+        uint16_t entry = table[schema_detail::slot(schema_detail::hash(name), hashing.seed, hashing.table_size)];
+        if (entry == 0 || names[entry - 1] != name) return std::nullopt;
+        return static_cast<size_t>(entry - 1);
+    }
+
+    /**
+     * Bind pyson text (one value per line) to a struct.
+     * Members that have no line in the text keep the values they had.
+     */
+    BindResult bind(std::string_view text, T& out, SchemaOptions options = {}) const {
+        std::array<bool, field_count> seen{};
+        size_t line_number = 0;
+        for (size_t start = 0; start < text.size(); line_number++) {
+            size_t end = text.find('\n', start);
+            if (end == std::string_view::npos) end = text.size();
+            std::string_view line = text.substr(start, end - start);
+            start = end + 1;
+
+            NamedValueView view;
+            if (!NamedValueView::from_line(line, view))
+                return failure(BindError::InvalidLine, line_number, std::string_view());
+            std::optional<size_t> index = field_index(view.name());
+            if (!index.has_value()) {
+                if (options.ignore_unknown) continue;
+                return failure(BindError::UnknownName, line_number, view.name());
+            }
+            if (view.type() != types[*index]) {
+                BindResult result = failure(BindError::WrongType, line_number, view.name());
+                result.expected = types[*index];
+                result.found = view.type();
+                return result;
+            }
+            if (seen[*index]) return failure(BindError::DuplicateName, line_number, view.name());
+            if (!decoders[*index](view, out)) return failure(BindError::InvalidValue, line_number, view.name());
+            seen[*index] = true;
+        }
+        if (options.require_all) {
+            for (size_t i = 0; i < field_count; i++) {
+                if (!seen[i]) return failure(BindError::MissingField, line_number, names[i]);
+            }
+        }
+        return BindResult{};
+    }
+
+    /**
+     * Bind a pyson file to a struct, the file is mapped into memory like a MappedFileReader.
+     * Throws an exception if the file can't be read, everything else is in the BindResult.
+     */
+    BindResult bind_file(const char *path, T& out, SchemaOptions options = {}) const {
+        FileMapping mapping(path, MapOptions{});
+        return bind(std::string_view(mapping.data(), mapping.size()), out, options);
+    }
+    BindResult bind_file(const std::string& path, T& out, SchemaOptions options = {}) const {
+        return bind_file(path.c_str(), out, options);
+    }
+};
+
+/// Make a Schema for a struct from its fields, see Schema for an example
+template <class T, class... Fields>
+constexpr Schema<T, Fields...> schema(Fields...) noexcept { return Schema<T, Fields...>{}; }
 }
 
 #endif
\ No newline at end of file
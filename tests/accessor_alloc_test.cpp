@@ -0,0 +1,99 @@
+// The reference and view accessors of Value and NamedValue, and the && overloads that move
+// out of them, make no copies of the payload: reading a string-heavy file through them
+// allocates nothing, however long the strings are. Allocations are counted by replacing
+// the global operator new, like bench/pyson_bench.cpp does.
+
+#include "pyson.hpp"
+#include "check.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+size_t allocations = 0;
+}
+
+void *operator new(size_t size) {
+    allocations++;
+    if (void *p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+constexpr size_t record_count = 2000;
+
+// Strings and list elements far longer than any small-string buffer, so every copy allocates
+std::string write_corpus() {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "pyson_accessor_alloc.pyson";
+    std::ofstream out(path, std::ios::binary);
+    for (size_t i = 0; i < record_count; i++) {
+        std::string payload(100 + i % 200, static_cast<char>('a' + i % 26));
+        out << "name_with_a_long_prefix_" << i << ':';
+        if (i % 2 == 0) out << "str:" << payload << '\n';
+        else out << "list:" << payload << "(*)" << payload << "(*)" << payload << '\n';
+    }
+    return path.string();
+}
+
+}
+
+int main() {
+    std::string path = write_corpus();
+    std::vector<pyson::NamedValue> values = pyson::FileReader(path).all();
+    PYSON_CHECK(values.size() == record_count);
+
+    // every reference and view accessor
+    size_t bytes = 0;
+    size_t before = allocations;
+    for (const pyson::NamedValue& named : values) {
+        bytes += named.name_ref().size() + named.name_view().size();
+        const pyson::Value& value = named.value_ref();
+        if (value.is_str()) {
+            bytes += value.string_ref_or_throw().size();
+            bytes += value.get_string_view()->size();
+            bytes += value.string_view_or("").size();
+        } else {
+            for (const std::string& element : value.list_span_or()) bytes += element.size();
+            bytes += value.get_list_span()->size();
+            bytes += value.list_ref_or_throw().size();
+        }
+    }
+    PYSON_CHECK(allocations == before);
+    PYSON_CHECK(bytes > record_count * 100);
+
+    // the copying accessors do allocate, so the counter is really counting
+    before = allocations;
+    for (const pyson::NamedValue& named : values) bytes += named.name().size();
+    PYSON_CHECK(allocations - before >= record_count);
+
+    // growing a vector moves the NamedValues instead of copying their payloads
+    std::vector<pyson::NamedValue> grown;
+    before = allocations;
+    for (pyson::NamedValue& named : values) grown.push_back(std::move(named));
+    PYSON_CHECK(allocations - before < 64);
+
+    // the && overloads move the payload out
+    before = allocations;
+    for (pyson::NamedValue& named : grown) {
+        pyson::Value value = std::move(named).value();
+        std::string name = std::move(named).name();
+        bytes += name.size();
+        if (value.is_str()) bytes += std::move(value).string_or_throw().size();
+        else bytes += std::move(value).list_or_throw().size();
+    }
+    PYSON_CHECK(allocations == before);
+
+    std::filesystem::remove(path);
+    return pyson_test::result();
+}
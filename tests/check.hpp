@@ -0,0 +1,26 @@
+// A tiny check macro for the pyson tests. Unlike assert(), it still checks in
+// Release builds (the default), and a failed check doesn't stop the other checks.
+
+#pragma once
+
+#include <cstdio>
+
+namespace pyson_test {
+
+inline int failures = 0;
+
+/// Exit code for main(): 0 if every check passed
+inline int result() {
+    if (failures != 0) std::fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
+
+}
+
+#define PYSON_CHECK(condition)                                                          \
+    do {                                                                                \
+        if (!(condition)) {                                                             \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            pyson_test::failures++;                                                     \
+        }                                                                               \
+    } while (false)
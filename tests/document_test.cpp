@@ -0,0 +1,62 @@
+// Document keeps its views valid through moves, even when the whole file fits in
+// the text's small-string buffer.
+
+#include "pyson.hpp"
+#include "check.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+#include <string>
+#include <utility>
+
+namespace {
+
+std::string write_file(const char *name, const char *text) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+    std::ofstream(path, std::ios::binary) << text;
+    return path.string();
+}
+
+void check_small(const pyson::Document& document) {
+    PYSON_CHECK(document.size() == 2);
+    PYSON_CHECK(document.name(0) == "a");
+    PYSON_CHECK(document.value(0).get_string() == "hi");
+    PYSON_CHECK(document.name(1) == "l");
+    PYSON_CHECK(document.value(1).list_or({}).size() == 2);
+    PYSON_CHECK(document.value_with_name("a").has_value());
+}
+
+}
+
+int main() {
+    std::string small = write_file("pyson_document_small.pyson", "a:str:hi\nl:list:x(*)y\n");
+    std::string other = write_file("pyson_document_other.pyson", "b:int:1\nc:str:there\n");
+
+    // move construction
+    pyson::Document original = pyson::FileReader(small).load_document();
+    check_small(original);
+    pyson::Document moved(std::move(original));
+    check_small(moved);
+    PYSON_CHECK(original.size() == 0);
+
+    // move assignment over a Document with its own arena
+    pyson::Document target = pyson::FileReader(other).load_document();
+    target = std::move(moved);
+    check_small(target);
+
+    // move assignment between Documents using a resource that isn't theirs
+    std::pmr::unsynchronized_pool_resource pool;
+    pyson::Document pooled = pyson::FileReader(other).load_document(&pool);
+    pooled = pyson::FileReader(small).load_document(&pool);
+    check_small(pooled);
+    PYSON_CHECK(pooled.resource() == &pool);
+
+    // a moved-from Document can be assigned to again
+    original = std::move(pooled);
+    check_small(original);
+
+    std::filesystem::remove(small);
+    std::filesystem::remove(other);
+    return pyson_test::result();
+}
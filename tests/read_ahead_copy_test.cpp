@@ -0,0 +1,54 @@
+// A copy of a FileReader that's reading ahead carries on from the original's line,
+// not from wherever the shared FILE was when read_ahead() was called.
+
+#include "pyson.hpp"
+#include "check.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+
+namespace {
+
+bool next_is(pyson::FileReader& reader, const char *name) {
+    std::optional<pyson::NamedValue> value = reader.next();
+    return value.has_value() && value->name_ref() == name;
+}
+
+}
+
+int main() {
+#if POSIX_FUNCTIONS_AVAILABLE
+    std::string path = (std::filesystem::temp_directory_path() / "pyson_read_ahead_copy.pyson").string();
+    std::ofstream(path, std::ios::binary) << "port:int:80\nhost:str:here\nratio:float:0.5\nname:str:x\n";
+
+    {
+        pyson::FileReader reader(path);
+        reader.remember_offsets();
+        reader.read_ahead();
+        PYSON_CHECK(next_is(reader, "port"));
+        PYSON_CHECK(next_is(reader, "host"));
+        pyson::FileReader copy(reader);
+        PYSON_CHECK(next_is(copy, "ratio"));
+        PYSON_CHECK(next_is(reader, "ratio"));
+        // the copy's remembered offsets still match its file
+        copy.go_to_line(1);
+        PYSON_CHECK(next_is(copy, "host"));
+    }
+    {
+        pyson::FileReader reader(path);
+        pyson::FileReader assigned(path);
+        reader.read_ahead();
+        PYSON_CHECK(next_is(reader, "port"));
+        assigned = reader;
+        PYSON_CHECK(next_is(assigned, "host"));
+        // moving keeps reading ahead from the same place
+        pyson::FileReader moved(std::move(reader));
+        PYSON_CHECK(next_is(moved, "host"));
+    }
+
+    std::filesystem::remove(path);
+#endif
+    return pyson_test::result();
+}
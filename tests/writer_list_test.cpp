@@ -0,0 +1,69 @@
+// FileWriter only refuses lists that the reader can't split back into the same elements,
+// checked by writing each list and reading it back with FileReader.
+
+#include "pyson.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using List = std::vector<std::string>;
+
+std::string test_path() {
+    return (std::filesystem::temp_directory_path() / "pyson_writer_list.pyson").string();
+}
+
+// Write a list and read it back, returns whether it came back unchanged
+bool round_trips(const List& list) {
+    {
+        pyson::FileWriter writer(test_path());
+        writer.write("l", pyson::Value(list));
+        writer.commit();
+    }
+    std::vector<pyson::NamedValue> values = pyson::FileReader(test_path()).all();
+    if (values.size() != 1) return false;
+    std::span<const std::string> back = values[0].value_ref().list_span_or();
+    return back.size() == list.size() && std::equal(back.begin(), back.end(), list.begin());
+}
+
+bool rejected(const List& list) {
+    pyson::FileWriter writer(test_path());
+    try {
+        writer.write("l", pyson::Value(list));
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+}
+
+int main() {
+    // elements ending in part of the separator still split back correctly
+    PYSON_CHECK(round_trips({"a(", "b"}));
+    PYSON_CHECK(round_trips({"a(*", "b"}));
+    PYSON_CHECK(round_trips({"(", "x"}));
+    PYSON_CHECK(round_trips({"(*", "*)"}));
+    PYSON_CHECK(round_trips({"a(", "*)b"}));
+    PYSON_CHECK(round_trips({"f("}));
+    PYSON_CHECK(round_trips({"a", "b("}));
+    PYSON_CHECK(round_trips({"a)", "*)b", "(x"}));
+    // an empty element is fine at the end
+    PYSON_CHECK(round_trips({""}));
+    PYSON_CHECK(round_trips({"a", ""}));
+
+    // these would read back as something else
+    PYSON_CHECK(rejected({}));
+    PYSON_CHECK(rejected({"a(*)b"}));
+    PYSON_CHECK(rejected({"", "b"}));
+    PYSON_CHECK(rejected({"a", "", "b"}));
+    PYSON_CHECK(rejected({"a\nb"}));
+
+    std::filesystem::remove(test_path());
+    return pyson_test::result();
+}